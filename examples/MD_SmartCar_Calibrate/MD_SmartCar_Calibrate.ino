@@ -145,6 +145,41 @@ void handlerR(char* param)
   Serial.print(F("\nSpin: "));
   Serial.print(Car.getSpinSP(), FP_SIG);
 
+  Serial.print(F("\nPID Period: "));
+  Serial.print(Car.getPIDPeriod());
+
+  {
+    uint16_t filter;
+    uint8_t slew;
+
+    Car.getPIDFilter(filter, slew);
+    Serial.print(F("\nPID Filter: "));
+    Serial.print(filter);
+    Serial.print(F(", "));
+    Serial.print(slew);
+  }
+
+  {
+    uint16_t accel, jerk;
+
+    Car.getMotionProfile(accel, jerk);
+    Serial.print(F("\nProfile: "));
+    Serial.print(accel);
+    Serial.print(F(", "));
+    Serial.print(jerk);
+  }
+
+  Serial.print(F("\nMove Velocity: "));
+  Serial.print(Car.getMoveVelocity());
+
+  Serial.print(F("\nPosition: "));
+  Serial.print(Car.getPositionGain(), FP_SIG);
+  Serial.print(F(", "));
+  Serial.print(Car.getMoveTolerance());
+
+  Serial.print(F("\nSync: "));
+  Serial.print(Car.getSyncGain(), FP_SIG);
+
   for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
   {
     Car.getPIDTuning(i, kp, ki, kd);
@@ -158,6 +193,19 @@ void handlerR(char* param)
     Serial.print(kd, FP_SIG);
   }
 
+  for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+  {
+    float ks, kv;
+
+    Car.getFeedForward(i, ks, kv);
+    Serial.print(F("\nFF"));
+    Serial.print(i);
+    Serial.print(F(": "));
+    Serial.print(ks, FP_SIG);
+    Serial.print(F(", "));
+    Serial.print(kv, FP_SIG);
+  }
+
   Serial.print(F("\n----\n"));
 }
 
@@ -192,6 +240,122 @@ void handlerTP(char* param)
     Car.setPIDTuning(i, fp, fi, fd);
 }
 
+void handlerTF(char* param)
+{
+  uint16_t m, is, iv;
+  char c;
+  float fs, fv;
+  bool bAll = (*param == '*');
+
+  if (bAll)
+    sscanf(param, "%c %d %d", &c, &is, &iv);
+  else
+    sscanf(param, "%d %d %d", &m, &is, &iv);
+  fs = (float)is / 100.0;
+  fv = (float)iv / 100.0;
+#if ECHO_COMMAND
+  Serial.print(F("\n> FF"));
+  if (!bAll) Serial.print(m);
+  Serial.print(F(" "));
+  Serial.print(fs, FP_SIG); Serial.print(", ");
+  Serial.print(fv, FP_SIG);
+#endif
+
+  // set the feed-forward based on range
+  uint8_t start = bAll ? 0 : m;
+  uint8_t end = bAll ? MD_SmartCar::MAX_MOTOR : m + 1;
+  for (uint8_t i = start; i < end; i++)
+    Car.setFeedForward(i, fs, fv);
+}
+
+void handlerTT(char* param)
+{
+  uint16_t v;
+
+  v = atoi(param);
+#if ECHO_COMMAND
+  Serial.print(F("\n> PID Period "));
+  Serial.print(v);
+#endif
+
+  if (!Car.setPIDPeriod(v))
+    Serial.print(F(" invalid"));
+}
+
+void handlerTL(char* param)
+{
+  uint16_t f, s;
+
+  sscanf(param, "%u %u", &f, &s);
+#if ECHO_COMMAND
+  Serial.print(F("\n> PID Filter "));
+  Serial.print(f); Serial.print(", ");
+  Serial.print(s);
+#endif
+
+  Car.setPIDFilter(f, s);
+}
+
+void handlerTA(char* param)
+{
+  uint16_t a, j;
+
+  sscanf(param, "%u %u", &a, &j);
+#if ECHO_COMMAND
+  Serial.print(F("\n> Profile "));
+  Serial.print(a); Serial.print(", ");
+  Serial.print(j);
+#endif
+
+  Car.setMotionProfile(a, j);
+}
+
+void handlerTV(char* param)
+{
+  uint16_t v;
+
+  v = atoi(param);
+#if ECHO_COMMAND
+  Serial.print(F("\n> Move Velocity "));
+  Serial.print(v);
+#endif
+
+  if (!Car.setMoveVelocity(v))
+    Serial.print(F(" invalid"));
+}
+
+void handlerTX(char* param)
+{
+  uint16_t k, t;
+  float f;
+
+  sscanf(param, "%u %u", &k, &t);
+  f = k / 100.0;
+#if ECHO_COMMAND
+  Serial.print(F("\n> Position "));
+  Serial.print(f, FP_SIG); Serial.print(", ");
+  Serial.print(t);
+#endif
+
+  Car.setPositionGain(f);
+  Car.setMoveTolerance(t);
+}
+
+void handlerTY(char* param)
+{
+  uint16_t v;
+  float f;
+
+  v = atoi(param);
+  f = v / 100.0;
+#if ECHO_COMMAND
+  Serial.print(F("\n> Sync "));
+  Serial.print(f, FP_SIG);
+#endif
+
+  Car.setSyncGain(f);
+}
+
 void handlerTW(char* param)
 {
   uint16_t l, h;
@@ -256,6 +420,34 @@ void handlerCS(char* param)
   Car.saveConfig(); 
 }
 
+void handlerCA(char* param)
+{
+  bool ff = (atoi(param) != 0);
+
+#if ECHO_COMMAND
+  Serial.print(F("\n> Auto calibrate "));
+  Serial.print(ff);
+#endif
+  Car.autoCalibrate(ff);
+}
+
+void handlerTU(char* param)
+{
+  uint16_t m, v, r;
+
+  sscanf(param, "%d %d %d", &m, &v, &r);
+#if ECHO_COMMAND
+  Serial.print(F("\n> Auto tune "));
+  Serial.print(m);
+  Serial.print(F(" "));
+  Serial.print(v);
+  Serial.print(F(" "));
+  Serial.print(r);
+#endif
+  if (r > SC_PID::NO_OVERSHOOT || !Car.autoTune(m, v, (SC_PID::tuneRule_t)r))
+    Serial.print(F("\n!! Bad parameters"));
+}
+
 void handlerCL(char* param) 
 {
 #if ECHO_COMMAND
@@ -289,10 +481,19 @@ const MD_cmdProcessor::cmdItem_t PROGMEM cmdTable[] =
   { "z",  handlerZ,    "a",       "Spin a% around vertical axis [-100, 100]", 2 },
   { "x",  handlerX,    "",        "Stop", 2 },
   { "tp", handlerTP,   "n p i d", "Tuning PID motor n or * [p,i,d=(float * 100)]", 3 },
+  { "tf", handlerTF,   "n s v",   "Tuning feed-forward motor n or * [s,v=(float * 100)] (0=off)", 3 },
+  { "tt", handlerTT,   "t",       "Tuning PID period t ms [5..1000]", 3 },
+  { "tl", handlerTL,   "f s",     "Tuning PID derivative filter f ms, output slew s PWM/period (0=off)", 3 },
+  { "ta", handlerTA,   "a j",     "Tuning profile accel a %/s, jerk j %/s/s (0=off)", 3 },
+  { "tv", handlerTV,   "v",       "Tuning profiled move() velocity v [1..100]", 3 },
+  { "tx", handlerTX,   "k t",     "Tuning move() position gain k [float * 100] (0=off), tolerance t pulses", 3 },
+  { "ty", handlerTY,   "k",       "Tuning wheel sync gain k [float * 100] (0=off)", 3 },
   { "tw", handlerTW,   "l h",     "Tuning PWM low/high [0..255]", 3},
   { "tk", handlerTK,   "p",       "Tuning drive() Kicker PWM [0..255]", 3 },
   { "tm", handlerTM,   "p",       "Tuning move() PWM [0..255]", 3 },
   { "ts", handlerTS,   "f",       "Tuning spin() derate [float * 100]", 3 },
+  { "tu", handlerTU,   "n v r",   "Tuning auto PID motor n at vel v [1..100], rule r [0=ZN PI,1=ZN PID,2=TL,3=some,4=no overshoot]", 3 },
+  { "ca", handlerCA,   "f",       "Configuration auto calibrate, f=1 to set feed-forward [wheels must be free to turn!]", 4 },
   { "cs", handlerCS,   "",        "Configuration Save", 4 },
   { "cl", handlerCL,   "",        "Configuration Load", 4 },
 };
@@ -351,6 +552,23 @@ void loop(void)
 {
   Car.run();
   CP.run();
+  if (Car.isMoveComplete())
+    Serial.print(F("\n> Move complete"));
+  if (Car.isCalibrateComplete())
+  {
+    Serial.print(F("\n> Calibrate complete, ppsMax "));
+    Serial.print(Car.getMaxPPS());
+    handlerR(nullptr);
+  }
+  for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+  {
+    if (Car.isTuneComplete(i))
+    {
+      Serial.print(F("\n> Tune complete "));
+      Serial.print(i);
+      handlerR(nullptr);
+    }
+  }
 #if USE_SONAR
   if (showSonar) readSonar();
 #endif
@@ -83,6 +83,9 @@ static enum
   CRUISE      // default operating when nothing else is running - move straight.
 } defaultBehavior = CRUISE, runBehavior = CRUISE;
 
+// Action sequence condition ids
+enum { COND_LEFT_CLEAR };
+
 // ------------------------------------
 // Global Variables
 // L29x type motor controller
@@ -278,6 +281,12 @@ void sendTelemetryData(void)
 //
 // 
 
+bool isLeftClear(void)
+// Sequence condition - more open space on the left than the right
+{
+  return(Sensors.sonarL > Sensors.sonarR);
+}
+
 bool activateEscape(void)
 // Check if the ESCAPE conditions are satisfied.
 // Escape will always take priority over any other behavior selected.
@@ -298,24 +307,17 @@ void doEscape(bool restart)
   const float REVERSE_ANGLE = PI/2; // radians
   const int16_t SPIN_PCT = 30;      // fraction %
 
-  static const PROGMEM MD_SmartCar::actionItem_t seqEscapeL[] =
+  static const PROGMEM MD_SmartCar::actionItem_t seqEscape[] =
   {
-    { MD_SmartCar::STOP },
-    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },
-    { MD_SmartCar::MOVE,  -REVERSE_ANGLE, -REVERSE_ANGLE },
-    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },
-    { MD_SmartCar::SPIN,  -SPIN_PCT },
-    { MD_SmartCar::END }
-  };
-
-  static const PROGMEM MD_SmartCar::actionItem_t seqEscapeR[] =
-  {
-    { MD_SmartCar::STOP },
-    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },
-    { MD_SmartCar::MOVE,  -REVERSE_ANGLE, -REVERSE_ANGLE },
-    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },
-    { MD_SmartCar::SPIN,  SPIN_PCT},
-    { MD_SmartCar::END }
+    { MD_SmartCar::STOP },                                // 0
+    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },            // 1
+    { MD_SmartCar::MOVE,  -REVERSE_ANGLE, -REVERSE_ANGLE }, // 2
+    { MD_SmartCar::PAUSE, ESCAPE_PAUSE_TIME },            // 3
+    { MD_SmartCar::JUMP_IFNOT, COND_LEFT_CLEAR, 7 },      // 4
+    { MD_SmartCar::SPIN,  -SPIN_PCT },                    // 5 - more space on the left
+    { MD_SmartCar::END },                                 // 6
+    { MD_SmartCar::SPIN,  SPIN_PCT },                     // 7 - more space on the right
+    { MD_SmartCar::END }                                  // 8
   };
 
   if (restart)
@@ -326,16 +328,7 @@ void doEscape(bool restart)
     if (Sensors.sonarM < DIST_IMPACT) TEL_MESG(" S");
 
     runBehavior = ESCAPE;
-    if (Sensors.sonarL > Sensors.sonarR)
-    {
-      TEL_MESG(": L");
-      Car.startSequence(seqEscapeL);
-    }
-    else
-    {
-      TEL_MESG(": R");
-      Car.startSequence(seqEscapeR);
-    }
+    Car.startSequence(seqEscape);   // turns to the most space after backing away
   }
   else if (Car.isSequenceComplete())
   {
@@ -380,7 +373,7 @@ void doAvoid(bool restart)
     turn = (1.0 - ((float)Sensors.sonarM/(float)DIST_OBSTACLE)) * (PI / 2.0);
     
     // now only AVOID if the difference is worthwhile
-    if (abs(turn - abs(seqAvoid[0].parm[1])) > DEADBAND)
+    if (abs(turn - abs(seqAvoid[0].getParm(1))) > DEADBAND)
     {
       runBehavior = AVOID;
       TEL_MESG("\nAVOIDER start");
@@ -393,7 +386,7 @@ void doAvoid(bool restart)
       TEL_VALUE(" ", turn);
 
       // modify the Avoid sequence with new value
-      seqAvoid[0].parm[1] = turn;
+      seqAvoid[0].setParm(1, turn);
 
       // now run the new Avoid sequence
       Car.startSequence(seqAvoid);
@@ -449,7 +442,7 @@ void doSeek(bool restart, bool toLight)
     TEL_VALUE(" ", turn);
 
     // modify the sequence with new value and run it
-    seqSeek[0].parm[1] = turn;
+    seqSeek[0].setParm(1, turn);
     Car.startSequence(seqSeek);
   }
   else if (Car.isSequenceComplete())
@@ -512,6 +505,7 @@ void setup(void)
   Sensors.begin();
   if (!Car.begin(PPR, PPS_MAX, DIA_WHEEL, LEN_BASE))   // take all the defaults
     TEL_MESG("\nUnable to start car!!\n");
+  Car.setSequenceCondition(COND_LEFT_CLEAR, isLeftClear);
 }
 
 void loop(void)
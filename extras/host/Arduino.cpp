@@ -0,0 +1,96 @@
+/**
+ * \file
+ * \brief Host (Linux) stand-in for the Arduino core - simulated time and I/O.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+static uint64_t _timeNow = 0;              // simulated time in us
+static uint8_t _pinIn[HOST_MAX_PIN];       // levels seen by digitalRead()
+static uint8_t _pinOut[HOST_MAX_PIN];      // levels set by digitalWrite()
+static int _pinPWM[HOST_MAX_PIN];          // values set by analogWrite()
+static void (*_isr[HOST_MAX_PIN])(void);   // attached interrupt handlers
+
+void hostReset(void)
+{
+  _timeNow = 0;
+  for (uint8_t i = 0; i < HOST_MAX_PIN; i++)
+  {
+    _pinIn[i] = HIGH;
+    _pinOut[i] = LOW;
+    _pinPWM[i] = 0;
+    _isr[i] = nullptr;
+  }
+}
+
+uint64_t hostMicros(void) { return(_timeNow); }
+
+void hostSetMicros(uint64_t us) { if (us > _timeNow) _timeNow = us; }
+
+void hostSetPin(uint8_t pin, uint8_t level) { if (pin < HOST_MAX_PIN) _pinIn[pin] = level; }
+
+uint8_t hostGetPin(uint8_t pin) { return(pin < HOST_MAX_PIN ? _pinOut[pin] : LOW); }
+
+int hostGetPWM(uint8_t pin) { return(pin < HOST_MAX_PIN ? _pinPWM[pin] : 0); }
+
+bool hostFireInterrupt(uint8_t irq)
+{
+  if (irq >= HOST_MAX_PIN || _isr[irq] == nullptr)
+    return(false);
+
+  _isr[irq]();
+  return(true);
+}
+
+uint32_t millis(void) { return((uint32_t)(_timeNow / 1000)); }
+uint32_t micros(void) { return((uint32_t)_timeNow); }
+void delay(uint32_t ms) { _timeNow += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { _timeNow += us; }
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < HOST_MAX_PIN && mode == INPUT_PULLUP)
+    _pinIn[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) { if (pin < HOST_MAX_PIN) _pinOut[pin] = (val ? HIGH : LOW); }
+int digitalRead(uint8_t pin) { return(pin < HOST_MAX_PIN ? _pinIn[pin] : LOW); }
+void analogWrite(uint8_t pin, int val) { if (pin < HOST_MAX_PIN) _pinPWM[pin] = val; }
+int analogRead(uint8_t pin) { (void)pin; return(0); }
+
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode)
+{
+  (void)mode;   // the simulator decides which edges generate interrupts
+  if (irq < HOST_MAX_PIN) _isr[irq] = isr;
+}
+
+void detachInterrupt(uint8_t irq) { if (irq < HOST_MAX_PIN) _isr[irq] = nullptr; }
+
+size_t HardwareSerial::print(long n, int base)
+{
+  if (base == DEC) return(printf("%ld", n));
+  return(print((unsigned long)n, base));
+}
+
+size_t HardwareSerial::print(unsigned long n, int base)
+{
+  switch (base)
+  {
+  case HEX: return(printf("%lX", n));
+  case OCT: return(printf("%lo", n));
+  case BIN:
+    {
+      char buf[sizeof(n) * 8 + 1];
+      char* p = &buf[sizeof(buf) - 1];
+
+      *p = '\0';
+      do { *--p = '0' + (n & 1); n >>= 1; } while (n != 0);
+      return(print(p));
+    }
+  default: return(printf("%lu", n));
+  }
+}
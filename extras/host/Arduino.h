@@ -0,0 +1,163 @@
+#pragma once
+/**
+ * \file
+ * \brief Host (Linux) stand-in for the Arduino core used by the MD_SmartCar library.
+ *
+ * Provides just enough of the Arduino API for the library sources to compile
+ * unchanged on a desktop machine. Time is fully simulated - millis() and micros()
+ * only advance when the simulator says so - which makes every run deterministic
+ * and lets the control code be stepped much faster than real time.
+ *
+ * The hostXXX() functions at the end of this file are the simulator side of
+ * the interface and do not exist on real hardware.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define LOW  0
+#define HIGH 1
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+#define HOST_MAX_PIN     32    ///< number of simulated digital pins
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#ifndef _BV
+#define _BV(bit) (1UL << (bit))
+#endif
+
+// PROGMEM is just normal memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s)    (s)
+#define memcpy_P memcpy
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p)   (*(void* const*)(p))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Interrupts are only ever fired by the simulator between library calls
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+#define cli() noInterrupts()
+#define sei() interrupts()
+
+// Time
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// Digital and analog I/O
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+
+// External interrupts - every simulated pin can be an interrupt pin
+inline int8_t digitalPinToInterrupt(uint8_t pin) { return(pin < HOST_MAX_PIN ? pin : NOT_AN_INTERRUPT); }
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+
+/**
+ * Minimal Serial replacement writing to stdout.
+ */
+class HardwareSerial
+{
+public:
+  void begin(uint32_t baud) { (void)baud; }
+  void end(void) {}
+  int available(void) { return(0); }
+  int read(void) { return(-1); }
+  int peek(void) { return(-1); }
+  int availableForWrite(void) { return(_txSpace); }
+  void flush(void) { fflush(stdout); }
+  operator bool(void) { return(true); }
+
+  size_t write(uint8_t c) { return(fputc(c, stdout) == EOF ? 0 : 1); }
+  size_t write(const uint8_t* buf, size_t len) { return(fwrite(buf, 1, len, stdout)); }
+
+  size_t print(const char* s) { return(fputs(s, stdout) == EOF ? 0 : strlen(s)); }
+  size_t print(char c) { return(write((uint8_t)c)); }
+  size_t print(unsigned char n, int base = DEC) { return(print((unsigned long)n, base)); }
+  size_t print(int n, int base = DEC) { return(print((long)n, base)); }
+  size_t print(unsigned int n, int base = DEC) { return(print((unsigned long)n, base)); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2) { return(printf("%.*f", digits, n)); }
+
+  template <typename T> size_t println(T v) { size_t n = print(v); return(n + print('\n')); }
+  template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return(n + print('\n')); }
+  size_t println(void) { return(print('\n')); }
+
+  uint16_t _txSpace = 64;   ///< simulated free space in the transmit buffer
+};
+
+extern HardwareSerial Serial;
+
+//--------------------------------------------------------------
+// Simulator side of the host interface
+
+/**
+ * Reset the simulated time base to 0 and clear all pin and interrupt state.
+ */
+void hostReset(void);
+
+/**
+ * Simulated time since hostReset() in microseconds (64 bit, never wraps).
+ */
+uint64_t hostMicros(void);
+
+/**
+ * Move the simulated clock forward. The clock never goes backwards.
+ *
+ * \param us the absolute simulated time in microseconds.
+ */
+void hostSetMicros(uint64_t us);
+
+/**
+ * Set the input level of a pin as seen by digitalRead().
+ */
+void hostSetPin(uint8_t pin, uint8_t level);
+
+/**
+ * Return the level last written to a pin with digitalWrite().
+ */
+uint8_t hostGetPin(uint8_t pin);
+
+/**
+ * Return the PWM value last written to a pin with analogWrite().
+ */
+int hostGetPWM(uint8_t pin);
+
+/**
+ * Invoke the ISR attached to an interrupt, if any.
+ *
+ * \return true if there was an ISR attached.
+ */
+bool hostFireInterrupt(uint8_t irq);
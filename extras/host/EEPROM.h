@@ -0,0 +1,34 @@
+#pragma once
+/**
+ * \file
+ * \brief Host (Linux) stand-in for the Arduino EEPROM library.
+ *
+ * Simulated 1 kbyte EEPROM held in RAM, erased (0xff) at startup.
+ */
+
+#include <Arduino.h>
+
+/**
+ * Simulated EEPROM with the same interface as the AVR EEPROM library.
+ */
+class EEPROMClass
+{
+public:
+  EEPROMClass(void) { erase(); }
+
+  uint8_t read(int idx) { return(_data[idx]); }
+  void write(int idx, uint8_t val) { _data[idx] = val; }
+  void update(int idx, uint8_t val) { _data[idx] = val; }
+  uint16_t length(void) { return(sizeof(_data)); }
+
+  /** Erase the whole EEPROM back to 0xff. Host only. */
+  void erase(void) { memset(_data, 0xff, sizeof(_data)); }
+
+  template <typename T> T& get(int idx, T& t) { memcpy((void*)&t, &_data[idx], sizeof(T)); return(t); }
+  template <typename T> const T& put(int idx, const T& t) { memcpy(&_data[idx], (const void*)&t, sizeof(T)); return(t); }
+
+private:
+  uint8_t _data[1024];
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,24 @@
+#pragma once
+/**
+ * \file
+ * \brief Host (Linux) stand-in for the MD_PWM library.
+ *
+ * PWM output is routed to analogWrite() so the simulator sees it through hostGetPWM().
+ */
+
+#include <Arduino.h>
+
+/**
+ * Simulated software PWM output on one pin.
+ */
+class MD_PWM
+{
+public:
+  MD_PWM(uint8_t pin) : _pin(pin) {}
+  bool begin(uint16_t freq) { (void)freq; return(true); }
+  bool disable(void) { analogWrite(_pin, 0); return(true); }
+  void write(uint8_t duty) { analogWrite(_pin, duty); }
+
+private:
+  uint8_t _pin;
+};
@@ -0,0 +1,188 @@
+/**
+ * \file
+ * \brief Class definition file for the SC_SimPlant class (host build only).
+ */
+
+#include "SC_SimPlant.h"
+
+// Quadrature encoder forward sequence of (A << 1) | B states
+const uint8_t SC_SimPlant::QUAD_STATE[4] = { 0b00, 0b10, 0b11, 0b01 };
+
+SC_SimPlant::SC_SimPlant(const motorPins_t& pinL, const motorPins_t& pinR, uint16_t ppr, uint16_t dWheel, uint16_t lBase)
+{
+  _nWheel = 2;
+  _mecanum = false;
+  _w[SIDE_L].pin = pinL;
+  _w[SIDE_R].pin = pinR;
+  _lenBase = lBase;
+  init(ppr, dWheel);
+}
+
+SC_SimPlant::SC_SimPlant(const motorPins_t& pinLF, const motorPins_t& pinRF, const motorPins_t& pinLR, const motorPins_t& pinRR,
+                         uint16_t ppr, uint16_t dWheel, uint16_t lBase, uint16_t lAxle, bool mecanum)
+{
+  _nWheel = 4;
+  _mecanum = mecanum;
+  _w[SIDE_L].pin = pinLF;
+  _w[SIDE_R].pin = pinRF;
+  _w[REAR_L].pin = pinLR;
+  _w[REAR_R].pin = pinRR;
+  _lenBase = lBase + (mecanum ? lAxle : 0);
+  init(ppr, dWheel);
+}
+
+void SC_SimPlant::init(uint16_t ppr, uint16_t dWheel)
+{
+  const wheelParam_t def = { 175.0, 0.08, 38, 30 };
+
+  _lenPerPulse = (PI * (float)dWheel) / (float)ppr;
+  for (uint8_t i = 0; i < _nWheel; i++)
+  {
+    _w[i].p = def;
+    _w[i].pos = 0.0;
+    _w[i].edges = 0;
+  }
+
+  reset();
+}
+
+void SC_SimPlant::reset(void)
+{
+  // Wheel positions are not reset, so the encoder outputs stay 
+  // consistent with the edge count. The current position becomes home.
+  for (uint8_t i = 0; i < _nWheel; i++)
+  {
+    _w[i].speed = 0.0;
+    _w[i].home = _w[i].edges;
+    setEncoder(_w[i]);
+  }
+  _x = _y = _theta = 0.0;
+}
+
+int16_t SC_SimPlant::getDrive(uint8_t side)
+// Work out the signed PWM from the controller pins
+{
+  const motorPins_t& pin = _w[side].pin;
+
+  if (pin.en != NO_PIN)   // L29x type, direction on In1/In2, PWM on En
+  {
+    uint8_t in1 = hostGetPin(pin.in1);
+    uint8_t in2 = hostGetPin(pin.in2);
+
+    if (in1 == in2) return(0);
+    return(in2 == HIGH ? hostGetPWM(pin.en) : -hostGetPWM(pin.en));
+  }
+
+  // MX1508 type, PWM on one direction pin and the other held low
+  return(hostGetPWM(pin.in1) - hostGetPWM(pin.in2));
+}
+
+void SC_SimPlant::advance(uint32_t us)
+{
+  uint64_t t = hostMicros();
+  uint64_t tEnd = t + us;
+
+  while (t < tEnd)
+  {
+    uint32_t dt = (tEnd - t < STEP_US) ? (uint32_t)(tEnd - t) : STEP_US;
+
+    step(dt / 1e6, t);
+    t += dt;
+    hostSetMicros(t);
+  }
+}
+
+void SC_SimPlant::setEncoder(wheel_t& w)
+// Set the encoder outputs to match the current edge count
+{
+  if (w.pin.encB == NO_PIN)
+    hostSetPin(w.pin.enc, (w.edges & 1) ? LOW : HIGH);
+  else
+  {
+    uint8_t state = QUAD_STATE[w.edges & 3];
+
+    hostSetPin(w.pin.enc, (state >> 1) & 1);
+    hostSetPin(w.pin.encB, state & 1);
+  }
+}
+
+void SC_SimPlant::encoderEdge(wheel_t& w)
+// Set the encoder outputs for the current edge count and fire the 
+// interrupt for the output that changed.
+{
+  uint8_t level = digitalRead(w.pin.enc);
+
+  setEncoder(w);
+  if (w.pin.encB == NO_PIN || digitalRead(w.pin.enc) != level)
+    hostFireInterrupt(digitalPinToInterrupt(w.pin.enc));
+  else
+    hostFireInterrupt(digitalPinToInterrupt(w.pin.encB));
+}
+
+void SC_SimPlant::step(float dt, uint64_t t0)
+{
+  double dPos[MAX_WHEEL] = { 0.0 };
+
+  for (uint8_t i = 0; i < _nWheel; i++)
+  {
+    wheel_t& w = _w[i];
+    int16_t u = getDrive(i);
+    int16_t uAbs = (u < 0 ? -u : u);
+    float target = 0.0;
+
+    // First order motor model with static friction at standstill and a
+    // stall threshold once running.
+    if (w.speed == 0.0 && uAbs < w.p.pwmStart)
+      target = 0.0;
+    else if (uAbs > w.p.pwmStall)
+      target = w.p.ppsMax * (float)(uAbs - w.p.pwmStall) / (float)(255 - w.p.pwmStall) * (u < 0 ? -1 : 1);
+
+    w.speed += (target - w.speed) * dt / w.p.tau;
+    if (target == 0.0 && fabs(w.speed) < 0.5)
+      w.speed = 0.0;    // friction finally stops it
+
+    // Move the wheel and generate an encoder edge for every pulse boundary
+    // crossed, at the time it was crossed.
+    double posOld = w.pos;
+    w.pos += w.speed * dt;
+    dPos[i] = w.pos - posOld;
+
+    int32_t eOld = (int32_t)floor(posOld);
+    int32_t eNew = (int32_t)floor(w.pos);
+    int8_t dir = (eNew > eOld) ? 1 : -1;
+
+    while (eOld != eNew)
+    {
+      double edge = (dir > 0) ? eOld + 1 : eOld;
+      double frac = (edge - posOld) / (w.pos - posOld);
+
+      hostSetMicros(t0 + (uint64_t)(frac * dt * 1e6));
+      eOld += dir;
+      w.edges += dir;
+      encoderEdge(w);
+    }
+  }
+
+  // Integrate the true pose (heading positive clockwise) from the average
+  // travel of each side. Mecanum wheels also move sideways, to the right 
+  // when the left front and right rear wheels turn forward and the others 
+  // in reverse.
+  double dL = dPos[SIDE_L] * _lenPerPulse;
+  double dR = dPos[SIDE_R] * _lenPerPulse;
+  double dLat = 0.0;
+
+  if (_nWheel == 4)
+  {
+    dL = (dL + dPos[REAR_L] * _lenPerPulse) / 2.0;
+    dR = (dR + dPos[REAR_R] * _lenPerPulse) / 2.0;
+    if (_mecanum)
+      dLat = ((dPos[SIDE_L] - dPos[SIDE_R] - dPos[REAR_L] + dPos[REAR_R]) * _lenPerPulse) / 4.0;
+  }
+
+  double dTheta = (dL - dR) / _lenBase;
+  double dCenter = (dL + dR) / 2.0;
+
+  _x += dCenter * cos(_theta + dTheta / 2.0) - dLat * sin(_theta + dTheta / 2.0);
+  _y += dCenter * sin(_theta + dTheta / 2.0) + dLat * cos(_theta + dTheta / 2.0);
+  _theta += dTheta;
+}
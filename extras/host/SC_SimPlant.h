@@ -0,0 +1,191 @@
+#pragma once
+/**
+ * \file
+ * \brief Header file for the SC_SimPlant drivetrain simulator (host build only).
+ */
+
+#include <Arduino.h>
+
+#ifndef NO_PIN
+#define NO_PIN 255    ///< Pin number when pin is not defined
+#endif
+
+/**
+ * Core object for the SC_SimPlant class
+ *
+ * Simulates two DC motors driving the wheels of a differential drive
+ * vehicle, or four for a skid steer or mecanum vehicle, with encoder 
+ * feedback into the library interrupt handlers.
+ */
+class SC_SimPlant
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Structures, Enumerated Types and Constants.
+   * @{
+   */
+  static const uint8_t SIDE_L = 0;        ///< Index for the left side (front) wheel
+  static const uint8_t SIDE_R = 1;        ///< Index for the right side (front) wheel
+  static const uint8_t REAR_L = 2;        ///< Index for the left rear wheel (4 wheels)
+  static const uint8_t REAR_R = 3;        ///< Index for the right rear wheel (4 wheels)
+  static const uint8_t MAX_WHEEL = 4;     ///< Maximum number of wheels
+  static const uint32_t STEP_US = 50;     ///< Integration step in microseconds
+
+  /**
+   * Motor controller and encoder pin connections for one wheel.
+   *
+   * For MX1508 type controllers (PWM on the direction pins) set en to NO_PIN.
+   * For single channel encoders set encB to NO_PIN.
+   */
+  typedef struct
+  {
+    uint8_t in1;   ///< controller In1 pin
+    uint8_t in2;   ///< controller In2 pin
+    uint8_t en;    ///< controller PWM enable pin (L29x type) or NO_PIN
+    uint8_t enc;   ///< encoder interrupt pin (A output for quadrature encoder)
+    uint8_t encB;  ///< quadrature encoder B output interrupt pin or NO_PIN
+  } motorPins_t;
+
+  /**
+   * Physical parameters for one motor/wheel.
+   */
+  typedef struct
+  {
+    float ppsMax;     ///< free running speed at PWM 255 in encoder edges per second
+    float tau;        ///< mechanical time constant in seconds
+    uint8_t pwmStart; ///< PWM needed to break away from standstill (static friction)
+    uint8_t pwmStall; ///< PWM below which a running motor stalls
+  } wheelParam_t;
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor.
+   *
+   * \param pinL   Left side motor connections.
+   * \param pinR   Right side motor connections.
+   * \param ppr    Number of encoder pulses per wheel revolution.
+   * \param dWheel Wheel diameter in mm.
+   * \param lBase  Base length (distance between wheel centers) in mm.
+   */
+  SC_SimPlant(const motorPins_t& pinL, const motorPins_t& pinR, uint16_t ppr, uint16_t dWheel, uint16_t lBase);
+
+  /**
+   * Class Constructor for a 4 wheel vehicle.
+   *
+   * Skid steer wheels all point forward and the vehicle turns like a differential
+   * drive vehicle on the average speed of each side. Mecanum wheels also move 
+   * the vehicle sideways and turn about both the wheel and axle centers, in the 
+   * same way as the library drive() and pose odometry.
+   *
+   * \param pinLF   Left front motor connections.
+   * \param pinRF   Right front motor connections.
+   * \param pinLR   Left rear motor connections.
+   * \param pinRR   Right rear motor connections.
+   * \param ppr     Number of encoder pulses per wheel revolution.
+   * \param dWheel  Wheel diameter in mm.
+   * \param lBase   Base length (distance between wheel centers) in mm.
+   * \param lAxle   Distance between the front and rear axles in mm.
+   * \param mecanum true for mecanum wheels, false for skid steer.
+   */
+  SC_SimPlant(const motorPins_t& pinLF, const motorPins_t& pinRF, const motorPins_t& pinLR, const motorPins_t& pinRR,
+              uint16_t ppr, uint16_t dWheel, uint16_t lBase, uint16_t lAxle, bool mecanum);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+   * @{
+   */
+  /**
+   * Set the physical parameters for one wheel.
+   *
+   * \param side the wheel index (SIDE_L, SIDE_R, REAR_L or REAR_R).
+   * \param p    the new parameters.
+   */
+  void setWheel(uint8_t side, const wheelParam_t& p) { if (side < _nWheel) _w[side].p = p; }
+
+  /**
+   * Reset the plant.
+   *
+   * Wheels are stopped, wheel positions read 0 and the vehicle is returned to 
+   * the origin facing along the x axis. Call this before starting the library 
+   * so that the encoder outputs are initialized.
+   */
+  void reset(void);
+
+  /**
+   * Advance the simulation.
+   *
+   * Integrate the plant forward by the specified time from the current simulated
+   * time, firing encoder interrupts as the edges occur. The simulated clock is
+   * left at the end of the interval.
+   *
+   * \param us the time interval in microseconds.
+   */
+  void advance(uint32_t us);
+
+  /**
+   * Get the wheel speed.
+   *
+   * \param side the wheel index (SIDE_L, SIDE_R, REAR_L or REAR_R).
+   * \return the current (signed) speed in encoder pulses per second.
+   */
+  float getSpeed(uint8_t side) { return(side < _nWheel ? _w[side].speed : 0); }
+
+  /**
+   * Get the wheel position.
+   *
+   * \param side the wheel index (SIDE_L, SIDE_R, REAR_L or REAR_R).
+   * \return the signed number of encoder edges since the last reset().
+   */
+  int32_t getPosition(uint8_t side) { return(side < _nWheel ? _w[side].edges - _w[side].home : 0); }
+
+  /**
+   * Get the true vehicle pose.
+   *
+   * The x axis is the direction the vehicle faces at reset(), y is to the right
+   * of it and the heading is positive clockwise, matching the library convention.
+   *
+   * \param x     x position in mm.
+   * \param y     y position in mm.
+   * \param theta heading in radians.
+   */
+  void getPose(float& x, float& y, float& theta) { x = _x; y = _y; theta = _theta; }
+
+  /**
+   * Get the motor drive level.
+   *
+   * \param side the wheel index (SIDE_L, SIDE_R, REAR_L or REAR_R).
+   * \return the signed PWM value currently applied to the motor.
+   */
+  int16_t getDrive(uint8_t side);
+  /** @} */
+
+private:
+  struct wheel_t
+  {
+    motorPins_t pin;  ///< connections for this wheel
+    wheelParam_t p;   ///< physical parameters
+    float speed;      ///< current speed in pulses/second (signed)
+    double pos;       ///< current position in pulses (signed)
+    int32_t edges;    ///< encoder edges generated (signed)
+    int32_t home;     ///< edge count at the last reset()
+  };
+
+  static const uint8_t QUAD_STATE[4]; ///< quadrature encoder output sequence
+
+  wheel_t _w[MAX_WHEEL];  ///< the wheels
+  uint8_t _nWheel;    ///< number of wheels in use
+  bool _mecanum;      ///< 4 wheels are mecanum wheels
+  float _lenPerPulse; ///< distance traveled for each encoder pulse (mm)
+  float _lenBase;     ///< wheel base in mm, effective turning base for mecanum
+  double _x, _y, _theta;  ///< true vehicle pose
+
+  void init(uint16_t ppr, uint16_t dWheel);  ///< common constructor initialization
+  void step(float dt, uint64_t t0);   ///< integrate one step from simulated time t0
+  void setEncoder(wheel_t& w);        ///< set the encoder outputs for the current edge count
+  void encoderEdge(wheel_t& w);       ///< generate the encoder output for an edge
+};
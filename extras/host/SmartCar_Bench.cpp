@@ -0,0 +1,311 @@
+// Host benchmarks for the MD_SmartCar control hot path.
+//
+// Times MD_SmartCar::run() in representative states, SC_PID::compute(),
+// drive() and the action sequence engine on the host build. The vehicle
+// is the same SC_SimPlant model as SmartCar_Sim, but only the library
+// calls are timed - the plant runs between the timed calls in simulated
+// time.
+//
+// For each path the mean time per call is reported in ns and, on x86,
+// in CPU cycles (from the time stamp counter), together with the longest
+// single call. The cost of reading the timers is measured first and taken
+// off the results. run() does almost nothing most of the time and runs a
+// PID step once every PID period, so its mean is dominated by the idle
+// calls and the maximum shows the cost of the PID steps.
+//
+// The results are for the host processor and compiler. They are useful to
+// compare one path or one version against another, and the ratios between
+// paths are a guide to the relative cost on the target, but they are not
+// the time taken on an AVR. On the host PROGMEM is normal memory, so the
+// PROGMEM sequence only measures the extra cost of reading the items.
+//
+// Usage: SmartCar_Bench [-n calls] [-p pid_period_ms]
+//   -n             number of calls timed for each path (default 100000).
+//   -p             set the PID period (default is the library default).
+//
+
+#include <MD_SmartCar.h>
+#include <EEPROM.h>
+#include <time.h>
+#include "SC_SimPlant.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES 1    ///< time stamp counter available
+#else
+#define BENCH_CYCLES 0    ///< time stamp counter available
+#endif
+
+// ------------------------------------
+// SmartCar Physical Constants (same as SmartCar_Sim)
+const uint16_t PPR = 40;        ///< Encoder pulses per revolution
+const uint16_t PPS_MAX = 175;   ///< Maximum encoder pulses per second (@ PWM=255)
+const uint16_t DIA_WHEEL = 65;  ///< Wheel diameter in mm
+const uint16_t LEN_BASE = 110;  ///< Wheel base in mm (= distance between wheel centers)
+
+const uint32_t LOOP_PERIOD = 1000;  ///< simulated time between run() calls in us
+
+// ------------------------------------
+// Global Variables
+SC_DCMotor_MX1508 ML(MC_INB1_PIN, MC_INB2_PIN);  // Left motor
+SC_DCMotor_MX1508 MR(MC_INA1_PIN, MC_INA2_PIN);  // Right motor
+
+SC_MotorEncoder EL(EN_L_PIN);                    // Left motor encoder
+SC_MotorEncoder ER(EN_R_PIN);                    // Right motor encoder
+
+MD_SmartCar Car(&ML, &EL, &MR, &ER);             // SmartCar object
+SC_SimPlant* Plant;                              // the simulated vehicle
+
+uint32_t benchCalls = 100000;   // calls timed for each path
+
+// Sequences for the sequence engine. The pause is repeated forever so
+// the sequence is still running at the end of the benchmark.
+const MD_SmartCar::actionItem_t PROGMEM seqConst[] =
+{
+  { MD_SmartCar::DRIVE, 50, 0 },
+  { MD_SmartCar::PAUSE, 60000 },
+  { MD_SmartCar::REPEAT, 0, 1 },
+  { MD_SmartCar::STOP, 0 },
+  { MD_SmartCar::END, 0 }
+};
+
+MD_SmartCar::actionItem_t seqRAM[] =
+{
+  { MD_SmartCar::DRIVE, 50, 0 },
+  { MD_SmartCar::PAUSE, 60000 },
+  { MD_SmartCar::REPEAT, 0, 1 },
+  { MD_SmartCar::STOP, 0 },
+  { MD_SmartCar::END, 0 }
+};
+
+// ------------------------------------
+// Timing
+
+struct stamp_t
+{
+  uint64_t ns;      // monotonic clock in ns
+  uint64_t cycles;  // time stamp counter, 0 if not available
+};
+
+struct result_t
+{
+  uint32_t n;       // number of calls timed
+  uint64_t ns;      // total ns
+  uint64_t cycles;  // total cycles
+  uint64_t maxNs;   // longest single call in ns
+};
+
+double overheadNs = 0.0;      // cost of a timed region with nothing in it
+double overheadCycles = 0.0;
+
+inline stamp_t now(void)
+{
+  stamp_t s;
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  s.ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#if BENCH_CYCLES
+  s.cycles = __rdtsc();
+#else
+  s.cycles = 0;
+#endif
+
+  return(s);
+}
+
+inline void record(result_t& r, const stamp_t& t0, const stamp_t& t1)
+{
+  uint64_t ns = t1.ns - t0.ns;
+
+  r.n++;
+  r.ns += ns;
+  r.cycles += t1.cycles - t0.cycles;
+  if (ns > r.maxNs) r.maxNs = ns;
+}
+
+void printResult(const char* name, const result_t& r)
+{
+  double ns = ((double)r.ns / r.n) - overheadNs;
+  double cyc = ((double)r.cycles / r.n) - overheadCycles;
+
+  if (ns < 0.0) ns = 0.0;
+  if (cyc < 0.0) cyc = 0.0;
+  printf("%-28s | %8u calls | %9.1f ns", name, r.n, ns);
+#if BENCH_CYCLES
+  printf(" | %9.0f cycles", cyc);
+#endif
+  printf(" | max %8.1f us\n", (double)r.maxNs / 1000.0);
+}
+
+void measureOverhead(void)
+{
+  result_t r = { 0, 0, 0, 0 };
+
+  for (uint32_t i = 0; i < benchCalls; i++)
+  {
+    stamp_t t0 = now();
+    stamp_t t1 = now();
+
+    record(r, t0, t1);
+  }
+  overheadNs = (double)r.ns / r.n;
+  overheadCycles = (double)r.cycles / r.n;
+  printf("Timer overhead %.1f ns", overheadNs);
+#if BENCH_CYCLES
+  printf(", %.0f cycles", overheadCycles);
+#endif
+  printf(" per call (taken off the results)\n\n");
+}
+
+// ------------------------------------
+// Benchmarks
+
+void reset(void)
+// Stop the car and let the vehicle come to rest
+{
+  Car.stop();
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    Plant->advance(LOOP_PERIOD);
+    Car.run();
+  }
+  Plant->reset();
+  Car.resetPose();
+}
+
+void benchRun(const char* name, uint32_t warmup = 2000)
+// Time run() in whatever state the car has been put into, after running
+// untimed for the warmup time (ms) so the state has settled.
+{
+  result_t r = { 0, 0, 0, 0 };
+
+  for (uint32_t i = 0; i < warmup; i++)
+  {
+    Plant->advance(LOOP_PERIOD);
+    Car.run();
+  }
+
+  for (uint32_t i = 0; i < benchCalls; i++)
+  {
+    stamp_t t0, t1;
+
+    Plant->advance(LOOP_PERIOD);
+    t0 = now();
+    Car.run();
+    t1 = now();
+    record(r, t0, t1);
+  }
+  printResult(name, r);
+}
+
+void benchDrive(void)
+// drive() with a new velocity each call, so it always recalculates
+{
+  result_t r = { 0, 0, 0, 0 };
+
+  for (uint32_t i = 0; i < benchCalls; i++)
+  {
+    stamp_t t0, t1;
+    int8_t v = 20 + (i % 60);
+
+    t0 = now();
+    Car.drive(v, (float)0.1);
+    t1 = now();
+    record(r, t0, t1);
+  }
+  printResult("drive()", r);
+}
+
+void benchPID(const char* name, float tf, uint16_t rate, float ks, float kv)
+// SC_PID::compute() on its own, with a current value that wanders
+// around the set point.
+{
+  int16_t cv = 0, co = 0, sp = 100;
+  SC_PID pid(&cv, &co, &sp, 0.4, 0.0, 0.15);
+  result_t r = { 0, 0, 0, 0 };
+
+  pid.setPIDPeriod(Car.getPIDPeriod());
+  pid.setDerivativeFilter(tf);
+  pid.setOutputRate(rate);
+  pid.setFeedForward(ks, kv);
+  pid.setMode(SC_PID::USER);
+
+  for (uint32_t i = 0; i < benchCalls; i++)
+  {
+    stamp_t t0, t1;
+
+    cv = sp + (int16_t)(i % 17) - 8;
+    t0 = now();
+    pid.compute();
+    t1 = now();
+    record(r, t0, t1);
+  }
+  printResult(name, r);
+}
+
+// ------------------------------------
+int main(int argc, char* argv[])
+{
+  uint16_t pidPeriod = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      benchCalls = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+      pidPeriod = strtoul(argv[++i], nullptr, 10);
+  }
+  if (benchCalls == 0) benchCalls = 1;
+
+  Plant = new SC_SimPlant({ MC_INB1_PIN, MC_INB2_PIN, NO_PIN, EN_L_PIN, NO_PIN },
+                          { MC_INA1_PIN, MC_INA2_PIN, NO_PIN, EN_R_PIN, NO_PIN },
+                          PPR, DIA_WHEEL, LEN_BASE);
+
+  hostReset();
+  Plant->reset();
+  EEPROM.erase();     // library defaults
+  if (!Car.begin(PPR, PPS_MAX, DIA_WHEEL, LEN_BASE))
+  {
+    printf("Car.begin() failed\n");
+    return(1);
+  }
+  if (pidPeriod != 0 && !Car.setPIDPeriod(pidPeriod))
+  {
+    printf("Invalid PID period %u\n", pidPeriod);
+    return(1);
+  }
+
+  printf("MD_SmartCar benchmarks, PID period %u ms, run() every %u us, PID %s point\n\n",
+    Car.getPIDPeriod(), LOOP_PERIOD, PID_FIXED_POINT ? "fixed" : "floating");
+  measureOverhead();
+
+  // run() in each of the main states
+  reset();
+  benchRun("run() idle");
+
+  Car.drive((int8_t)50, (int8_t)0);
+  benchRun("run() drive");
+  reset();
+
+  Car.move((float)(2 * PI * 500), (float)(2 * PI * 500));  // long enough not to finish
+  benchRun("run() move");
+  reset();
+
+  Car.startSequence(seqRAM);
+  benchRun("run() sequence RAM");
+  reset();
+
+  Car.startSequence(seqConst);
+  benchRun("run() sequence PROGMEM");
+  reset();
+
+  // the individual calls
+  benchDrive();
+  reset();
+
+  benchPID("SC_PID::compute()", 0.0, 0, 0.0, 0.0);
+  benchPID("SC_PID::compute() filtered", 0.5, 10, 0.0, 0.0);
+  benchPID("SC_PID::compute() ff", 0.0, 0, 30.0, 1.3);
+
+  return(0);
+}
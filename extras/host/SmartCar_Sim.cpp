@@ -0,0 +1,554 @@
+// Host simulation of a MD_SmartCar vehicle.
+//
+// Steps MD_SmartCar::run() against the SC_SimPlant differential drive model
+// and reports settling time and tracking error for drive(), move() and spin(),
+// and the error in the library odometry pose at the end of each scenario.
+// Everything runs in simulated time, so the results are repeatable and the
+// whole suite runs in a fraction of a second.
+//
+// Built with SC_MOTOR_COUNT 4 (make DEFS=-DSC_MOTOR_COUNT=4) the vehicle is a 4 wheel
+// skid steer, or mecanum with -k.
+//
+// Usage: SmartCar_Sim [-q] [-p pid_period_ms] [-t] [-m mismatch_%] [-s sync_gain] [-l accel_%/s] [-g pos_gain] [-d filter_ms] [-r slew] [-e alpha_%] [-f] [-c] [-a rule] [-i] [-k] [loop_period_us]
+//   -q             use quadrature encoders (SC_MotorEncoderQuad) instead of single channel.
+//   -p             set the PID period (default is the library default).
+//   -t             run the speed control from a simulated timer interrupt calling tick().
+//   -m             make the right motor(s) this percentage slower than the left.
+//   -s             set the wheel synchronization gain (default is the library default).
+//   -l             set the motion profile acceleration limit in %/s (default is the library default, off).
+//   -g             set the move() position control gain (default is the library default, off).
+//   -d             set the PID derivative filter time constant in ms.
+//   -r             set the PID output slew limit in PWM per PID period.
+//   -e             set the encoder speed filter alpha gain in % (100 for no filter).
+//   -f             set the feed-forward motor model from the (left) wheel parameters.
+//   -c             run autoCalibrate() and use the calibrated configuration (with -f, also the feed-forward).
+//   -a             run autoTune() on both motors with this SC_PID::tuneRule_t and use the tuned PID parameters.
+//   -i             collect the library loop timing statistics and print them at the end.
+//   -k             4 motor build only, use mecanum wheels and add a sideways drive() scenario.
+//   loop_period_us is the simulated time between calls to run() (default 1000).
+//
+
+#include <MD_SmartCar.h>
+#include <EEPROM.h>
+#include "SC_SimPlant.h"
+
+// ------------------------------------
+// SmartCar Physical Constants (same as the example sketches)
+const uint16_t PPR = 40;        ///< Encoder pulses per revolution
+const uint16_t PPS_MAX = 175;   ///< Maximum encoder pulses per second (@ PWM=255)
+const uint8_t QUAD_FACTOR = 2;  ///< Quadrature encoder has this many more pulses per revolution
+const uint8_t EN_LB_PIN = 11;   ///< Left quadrature encoder B output
+const uint8_t EN_RB_PIN = 12;   ///< Right quadrature encoder B output
+const uint16_t DIA_WHEEL = 65;  ///< Wheel diameter in mm
+const uint16_t LEN_BASE = 110;  ///< Wheel base in mm (= distance between wheel centers)
+#if SC_MOTOR_COUNT == 4
+const uint16_t LEN_AXLE = 120;  ///< Distance between front and rear axles in mm
+const uint8_t MC_RL1_PIN = 13;  ///< Rear left motor In1
+const uint8_t MC_RL2_PIN = 14;  ///< Rear left motor In2
+const uint8_t MC_RR1_PIN = 15;  ///< Rear right motor In1
+const uint8_t MC_RR2_PIN = 16;  ///< Rear right motor In2
+const uint8_t EN_RL_PIN = 17;   ///< Rear left motor encoder
+const uint8_t EN_RR_PIN = 18;   ///< Rear right motor encoder
+const uint8_t EN_RLB_PIN = 19;  ///< Rear left quadrature encoder B output
+const uint8_t EN_RRB_PIN = 20;  ///< Rear right quadrature encoder B output
+#endif
+
+const uint32_t SAMPLE_PERIOD = 10;   ///< metrics sample period in ms
+const float SETTLE_BAND = 0.05;      ///< settled when within this fraction of target
+
+// ------------------------------------
+// Global Variables
+SC_DCMotor_MX1508 ML(MC_INB1_PIN, MC_INB2_PIN);  // Left motor
+SC_DCMotor_MX1508 MR(MC_INA1_PIN, MC_INA2_PIN);  // Right motor
+
+SC_MotorEncoder* EL;                             // Left motor encoder
+SC_MotorEncoder* ER;                             // Right motor encoder
+#if SC_MOTOR_COUNT == 4
+SC_DCMotor_MX1508 MRL(MC_RL1_PIN, MC_RL2_PIN);   // Rear left motor
+SC_DCMotor_MX1508 MRR(MC_RR1_PIN, MC_RR2_PIN);   // Rear right motor
+
+SC_MotorEncoder* ERL;                            // Rear left motor encoder
+SC_MotorEncoder* ERR;                            // Rear right motor encoder
+#endif
+
+MD_SmartCar* Car;                                // SmartCar object
+SC_SimPlant* Plant;                              // the simulated vehicle
+
+uint32_t loopPeriod = 1000;   // simulated loop() period in us
+bool timerTick = false;       // speed control is run by tick()
+uint32_t nextRun;             // micros() for the next run() call
+uint32_t nextTick;            // micros() for the next tick() call
+uint16_t ppr = PPR;           // encoder pulses per revolution
+uint16_t ppsMax = PPS_MAX;    // encoder pulses per second at full speed
+float lenTurn = LEN_BASE;     // effective turning base in mm
+
+// ------------------------------------
+// Simulation helpers
+
+void runFor(uint32_t ms, void (*sample)(uint32_t t) = nullptr)
+// Run the car and plant for the specified simulated time,
+// calling the sampler every SAMPLE_PERIOD.
+{
+  uint32_t timeStart = millis();
+  uint32_t timeSample = timeStart;
+
+  while (millis() - timeStart < ms)
+  {
+    uint32_t step = nextRun - micros();
+
+    // the timer interrupt happens whatever loop() is doing
+    if (timerTick && nextTick - micros() < step)
+      step = nextTick - micros();
+    Plant->advance(step);
+
+    if (timerTick && micros() == nextTick)
+    {
+      nextTick += Car->getPIDPeriod() * 1000UL;
+      Car->tick();
+    }
+
+    if (micros() == nextRun)
+    {
+      nextRun += loopPeriod;
+      Car->run();
+
+      if (sample != nullptr && millis() - timeSample >= SAMPLE_PERIOD)
+      {
+        timeSample += SAMPLE_PERIOD;
+        sample(timeSample - timeStart);
+      }
+    }
+  }
+}
+
+void printPoseError(void)
+// Compare the library odometry to the true pose
+{
+  float x, y, theta;
+  float xT, yT, thetaT;
+
+  Car->getPose(x, y, theta);
+  Plant->getPose(xT, yT, thetaT);
+  theta = (theta - thetaT) * 180.0 / PI;
+  while (theta > 180.0) theta -= 360.0;
+  while (theta <= -180.0) theta += 360.0;
+
+  printf(" | odo err %5.1f mm %5.1f deg\n", sqrt((x - xT) * (x - xT) + (y - yT) * (y - yT)), theta);
+}
+
+void settle(void)
+// Stop everything and wait for the vehicle to come to rest
+{
+  Car->stop();
+  runFor(1000);
+  printPoseError();
+  Plant->reset();
+  Car->resetPose();
+}
+
+// ------------------------------------
+// drive() metrics, combined for the wheels each side (even wheels are left)
+const uint8_t WHEELS = MD_SmartCar::MAX_MOTOR;
+
+struct
+{
+  float target[WHEELS]; // target speed in pps
+  uint32_t settled[2];  // last time out of the settling band
+  double sumSq[2];      // sum of squared error after settling time
+  uint32_t n;           // number of samples in sumSq for each wheel
+} drv;
+
+void sampleDrive(uint32_t t)
+{
+  const uint32_t TRACK_START = 1000;   // ms before tracking error counts
+
+  for (uint8_t i = 0; i < WHEELS; i++)
+  {
+    float err = Plant->getSpeed(i) - drv.target[i];
+
+    if (fabs(err) > SETTLE_BAND * fabs(drv.target[i]))
+      drv.settled[i & 1] = t;
+    if (t >= TRACK_START)
+      drv.sumSq[i & 1] += err * err;
+  }
+  if (t >= TRACK_START) drv.n++;
+}
+
+double rmsDrive(uint8_t side)
+// rms error for the wheels on one side
+{
+  return(drv.n ? sqrt(drv.sumSq[side] / (drv.n * (WHEELS / 2))) : 0.0);
+}
+
+void scenarioDrive(int8_t vLinear, int8_t vAngularD, uint32_t duration)
+{
+  float spL, spR;
+  float lenPerPulse = (PI * DIA_WHEEL) / ppr;
+  float w = -(PI * vAngularD) / 180.0;
+
+  // expected wheel speeds from the unicycle model (see MD_SmartCar::drive())
+  spL = spR = (ppsMax * (float)vLinear) / 100.0;
+  spL -= (w * (lenTurn / lenPerPulse)) / 2;
+  spR += (w * (lenTurn / lenPerPulse)) / 2;
+
+  memset(&drv, 0, sizeof(drv));
+  for (uint8_t i = 0; i < WHEELS; i++)
+    drv.target[i] = (i & 1) ? spR : spL;
+
+  Car->drive(vLinear, vAngularD);
+  runFor(duration, sampleDrive);
+
+  {
+    float x, y, theta;
+    float thetaExp = (-w * duration) / MS_PER_SEC;   // heading expected from the set points
+
+    Plant->getPose(x, y, theta);
+    printf("drive(%4d,%4d)  target L %6.1f R %6.1f pps | settle L %5u R %5u ms | rms err L %5.2f R %5.2f pps | hdg err %6.1f deg",
+      vLinear, vAngularD, spL, spR, drv.settled[0], drv.settled[1],
+      rmsDrive(0), rmsDrive(1),
+      ((theta - thetaExp) * 180.0) / PI);
+  }
+
+  settle();
+}
+
+#if SC_MOTOR_COUNT == 4
+void scenarioStrafe(int8_t vLateral, uint32_t duration)
+// Mecanum sideways drive(), the left front and right rear wheels turn
+// forward to move right and the others in reverse.
+{
+  float sp = (ppsMax * (float)vLateral) / 100.0;
+
+  memset(&drv, 0, sizeof(drv));
+  for (uint8_t i = 0; i < WHEELS; i++)
+    drv.target[i] = (i == SC_SimPlant::SIDE_L || i == SC_SimPlant::REAR_R) ? sp : -sp;
+
+  Car->drive(0, vLateral, 0.0);
+  runFor(duration, sampleDrive);
+
+  {
+    float x, y, theta;
+
+    Plant->getPose(x, y, theta);
+    printf("strafe(%4d)     target %6.1f pps      | settle L %5u R %5u ms | rms err L %5.2f R %5.2f pps | hdg err %6.1f deg",
+      vLateral, sp, drv.settled[0], drv.settled[1], rmsDrive(0), rmsDrive(1), (theta * 180.0) / PI);
+  }
+
+  settle();
+}
+#endif
+
+// ------------------------------------
+// move() and spin() metrics
+
+uint32_t runUntilIdle(uint32_t timeout)
+// Run until the car stops moving, return the time taken
+{
+  uint32_t timeStart = millis();
+
+  do
+    runFor(SAMPLE_PERIOD);
+  while (Car->isRunning() && millis() - timeStart < timeout);
+
+  return(millis() - timeStart);
+}
+
+void scenarioMove(int16_t angL, int16_t angR)
+{
+  int32_t target[2] = { (int32_t)angL * ppr / 360, (int32_t)angR * ppr / 360 };
+  uint32_t t;
+
+  Car->move(angL, angR);
+  t = runUntilIdle(5000);
+  runFor(500);    // allow coasting to finish
+
+  printf("move(%4d,%4d)   target L %6d R %6d p   | done %5u ms %-9s| final err L %5d R %5d p",
+    angL, angR, target[0], target[1], t, Car->isMoveComplete() ? "complete" : "",
+    Plant->getPosition(0) - target[0], Plant->getPosition(1) - target[1]);
+
+  settle();
+}
+
+void scenarioSpin(int16_t fraction)
+{
+  float x, y, theta;
+  float target = 360.0 * fraction / 100.0;
+  uint32_t t;
+
+  Car->spin(fraction);
+  t = runUntilIdle(5000);
+  runFor(500);    // allow coasting to finish
+
+  Plant->getPose(x, y, theta);
+  theta = theta * 180.0 / PI;
+  printf("spin(%4d)       target %6.1f deg      | done %5u ms %-9s| final err %6.1f deg",
+    fraction, target, t, Car->isMoveComplete() ? "complete" : "", theta - target);
+
+  settle();
+}
+
+// ------------------------------------
+int main(int argc, char* argv[])
+{
+  bool quad = false;
+  uint16_t pidPeriod = 0;
+  float mismatch = 0.0;
+  float syncGain = -1.0;
+  int32_t accelMax = -1;
+  float posGain = -1.0;
+  bool timingStats = false;
+  bool feedForward = false;
+  bool calibrate = false;
+  int8_t tuneRule = -1;
+  uint16_t pidFilter = 0;
+  uint8_t pidSlew = 0;
+  uint8_t speedAlpha = 0;
+  bool mecanum = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-q") == 0)
+      quad = true;
+    else if (strcmp(argv[i], "-t") == 0)
+      timerTick = true;
+    else if (strcmp(argv[i], "-f") == 0)
+      feedForward = true;
+    else if (strcmp(argv[i], "-i") == 0)
+      timingStats = true;
+    else if (strcmp(argv[i], "-c") == 0)
+      calibrate = true;
+    else if (strcmp(argv[i], "-k") == 0)
+      mecanum = true;
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+      pidPeriod = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+      mismatch = strtod(argv[++i], nullptr);
+    else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+      pidFilter = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      pidSlew = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+      speedAlpha = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+      tuneRule = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      syncGain = strtod(argv[++i], nullptr);
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+      accelMax = strtol(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+      posGain = strtod(argv[++i], nullptr);
+    else
+      loopPeriod = strtoul(argv[i], nullptr, 10);
+  }
+  if (loopPeriod == 0) loopPeriod = 1000;
+
+  if (quad)
+  {
+    ppr *= QUAD_FACTOR;
+    ppsMax *= QUAD_FACTOR;
+    EL = new SC_MotorEncoderQuad(EN_L_PIN, EN_LB_PIN);
+    ER = new SC_MotorEncoderQuad(EN_R_PIN, EN_RB_PIN);
+#if SC_MOTOR_COUNT == 4
+    ERL = new SC_MotorEncoderQuad(EN_RL_PIN, EN_RLB_PIN);
+    ERR = new SC_MotorEncoderQuad(EN_RR_PIN, EN_RRB_PIN);
+#endif
+  }
+  else
+  {
+    EL = new SC_MotorEncoder(EN_L_PIN);
+    ER = new SC_MotorEncoder(EN_R_PIN);
+#if SC_MOTOR_COUNT == 4
+    ERL = new SC_MotorEncoder(EN_RL_PIN);
+    ERR = new SC_MotorEncoder(EN_RR_PIN);
+#endif
+  }
+#if SC_MOTOR_COUNT == 4
+  Car = new MD_SmartCar(&ML, EL, &MR, ER, &MRL, ERL, &MRR, ERR, mecanum ? MD_SmartCar::MECANUM : MD_SmartCar::SKID_STEER);
+  Plant = new SC_SimPlant({ MC_INB1_PIN, MC_INB2_PIN, NO_PIN, EN_L_PIN, (uint8_t)(quad ? EN_LB_PIN : NO_PIN) },
+                          { MC_INA1_PIN, MC_INA2_PIN, NO_PIN, EN_R_PIN, (uint8_t)(quad ? EN_RB_PIN : NO_PIN) },
+                          { MC_RL1_PIN, MC_RL2_PIN, NO_PIN, EN_RL_PIN, (uint8_t)(quad ? EN_RLB_PIN : NO_PIN) },
+                          { MC_RR1_PIN, MC_RR2_PIN, NO_PIN, EN_RR_PIN, (uint8_t)(quad ? EN_RRB_PIN : NO_PIN) },
+                          ppr, DIA_WHEEL, LEN_BASE, LEN_AXLE, mecanum);
+  if (mecanum) lenTurn = LEN_BASE + LEN_AXLE;
+#else
+  if (mecanum)
+  {
+    printf("-k needs a 4 motor build\n");
+    return(1);
+  }
+  Car = new MD_SmartCar(&ML, EL, &MR, ER);
+  Plant = new SC_SimPlant({ MC_INB1_PIN, MC_INB2_PIN, NO_PIN, EN_L_PIN, (uint8_t)(quad ? EN_LB_PIN : NO_PIN) },
+                          { MC_INA1_PIN, MC_INA2_PIN, NO_PIN, EN_R_PIN, (uint8_t)(quad ? EN_RB_PIN : NO_PIN) },
+                          ppr, DIA_WHEEL, LEN_BASE);
+#endif
+
+  // both wheels run at the default speed, scaled for the encoder resolution,
+  // less any mismatch for the right wheel
+  SC_SimPlant::wheelParam_t wp = { (float)ppsMax, 0.08, 38, 30 };
+
+  for (uint8_t i = SC_SimPlant::SIDE_L; i < WHEELS; i += 2)
+    Plant->setWheel(i, wp);
+  wp.ppsMax *= (100.0 - mismatch) / 100.0;
+  for (uint8_t i = SC_SimPlant::SIDE_R; i < WHEELS; i += 2)
+    Plant->setWheel(i, wp);
+
+  hostReset();
+  Plant->reset();
+  EEPROM.erase();     // library defaults
+#if SC_MOTOR_COUNT == 4
+  if (!Car->begin(ppr, ppsMax, DIA_WHEEL, LEN_BASE, LEN_AXLE))
+#else
+  if (!Car->begin(ppr, ppsMax, DIA_WHEEL, LEN_BASE))
+#endif
+  {
+    printf("Car.begin() failed\n");
+    return(1);
+  }
+  if (pidPeriod != 0 && !Car->setPIDPeriod(pidPeriod))
+  {
+    printf("Invalid PID period %u\n", pidPeriod);
+    return(1);
+  }
+  if (syncGain >= 0.0)
+    Car->setSyncGain(syncGain);
+  if (accelMax >= 0)
+  {
+    uint16_t a, j;
+
+    Car->getMotionProfile(a, j);
+    Car->setMotionProfile(accelMax, j);
+  }
+  if (posGain >= 0.0)
+    Car->setPositionGain(posGain);
+  Car->setPIDFilter(pidFilter, pidSlew);
+  if (speedAlpha != 0 && !Car->setSpeedFilter(speedAlpha))
+  {
+    printf("Invalid speed filter %u\n", speedAlpha);
+    return(1);
+  }
+  if (feedForward && !calibrate)
+  {
+    // the plant speed is linear in PWM above the stall threshold
+    for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+      Car->setFeedForward(i, wp.pwmStall, (255.0 - wp.pwmStall) / ppsMax);
+  }
+  Car->setTimerTick(timerTick);
+  nextRun = micros() + loopPeriod;
+  nextTick = micros() + Car->getPIDPeriod() * 1000UL;
+
+  if (calibrate)
+  {
+    uint32_t t;
+
+    Car->autoCalibrate(feedForward);
+    t = runUntilIdle(60000);
+    if (!Car->isCalibrateComplete())
+    {
+      printf("autoCalibrate() failed\n");
+      return(1);
+    }
+    ppsMax = Car->getMaxPPS();
+    printf("autoCalibrate() %u ms: PWM %u-%u, kicker %u, move %u, ppsMax %u\n", t,
+      Car->getMinMotorSP(), Car->getMaxMotorSP(), Car->getKickerSP(), Car->getMoveSP(), ppsMax);
+    for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+    {
+      float kp, ki, kd, ks, kv;
+
+      Car->getPIDTuning(i, kp, ki, kd);
+      Car->getFeedForward(i, ks, kv);
+      printf("  motor %u: PID %.2f, %.2f, %.2f FF %.2f, %.3f\n", i, kp, ki, kd, ks, kv);
+    }
+    printf("\n");
+    Car->stop();
+    runFor(1000);
+    Plant->reset();
+    Car->resetPose();
+  }
+
+  if (tuneRule >= 0)
+  {
+    const uint8_t TUNE_VEL = 50;  // % of max speed
+    uint32_t t;
+
+    for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+    {
+      if (!Car->autoTune(i, TUNE_VEL, (SC_PID::tuneRule_t)tuneRule))
+      {
+        printf("autoTune() invalid parameters\n");
+        return(1);
+      }
+    }
+    t = runUntilIdle(60000);
+    printf("autoTune() %u ms at %u%%, rule %d\n", t, TUNE_VEL, tuneRule);
+    for (uint8_t i = 0; i < MD_SmartCar::MAX_MOTOR; i++)
+    {
+      float kp, ki, kd;
+
+      if (!Car->isTuneComplete(i))
+      {
+        printf("autoTune() motor %u failed\n", i);
+        return(1);
+      }
+      Car->getPIDTuning(i, kp, ki, kd);
+      printf("  motor %u: PID %.2f, %.2f, %.2f\n", i, kp, ki, kd);
+    }
+    printf("\n");
+    Car->stop();
+    runFor(1000);
+    Plant->reset();
+    Car->resetPose();
+  }
+
+#if SC_MOTOR_COUNT == 4
+  printf("MD_SmartCar simulation, 4 motor %s, loop period %u us, %s encoders\n", 
+    mecanum ? "mecanum" : "skid steer", loopPeriod, quad ? "quadrature" : "single channel");
+#else
+  printf("MD_SmartCar simulation, loop period %u us, %s encoders\n", loopPeriod, quad ? "quadrature" : "single channel");
+#endif
+  printf("PID period %u ms run from %s, wheel sync gain %.2f", Car->getPIDPeriod(), timerTick ? "tick()" : "run()", Car->getSyncGain());
+  printf(", PID filter %u ms slew %u, speed filter %u%%", pidFilter, pidSlew, Car->getSpeedFilter());
+  printf(", right motor %.0f%% slower, %s feed-forward", mismatch, feedForward ? "with" : "no");
+  {
+    uint16_t a, j;
+
+    Car->getMotionProfile(a, j);
+    printf(", profile accel %u jerk %u, position gain %.2f\n\n", a, j, Car->getPositionGain());
+  }
+
+  Car->setTimingStats(timingStats);
+
+  scenarioDrive(30, 0, 5000);
+  scenarioDrive(60, 0, 5000);
+  scenarioDrive(90, 0, 5000);
+  scenarioDrive(50, 30, 5000);
+  scenarioDrive(-50, 0, 5000);
+#if SC_MOTOR_COUNT == 4
+  if (mecanum)
+  {
+    scenarioStrafe(50, 5000);
+    scenarioStrafe(-30, 5000);
+  }
+#endif
+
+  scenarioMove(360, 360);
+  scenarioMove(720, -720);
+  scenarioMove(-180, -180);
+
+  scenarioSpin(25);
+  scenarioSpin(-50);
+
+  printf("\nSimulated %u ms\n", millis());
+
+  if (timingStats)
+  {
+    MD_SmartCar::timingStats_t ts;
+
+    Car->getTimingStats(ts);
+    printf("run() %u calls, mean %u us, max %u us | between calls mean %u us, max %u us\n",
+      ts.runCount, ts.runMean, ts.runMax, ts.loopMean, ts.loopMax);
+    printf("PID %u steps, late mean %.2f ms, max %u ms, %u missed | encoder %u interrupts/s\n",
+      ts.pidCount, ts.pidLateMean, ts.pidLateMax, ts.pidMissed, ts.isrRate);
+  }
+
+  return(0);
+}
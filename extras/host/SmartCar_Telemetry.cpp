@@ -0,0 +1,329 @@
+// Host decoder for the MD_SmartCar binary telemetry and debug log.
+//
+// Reads the serial stream from a vehicle built with PID_TUNE or SCDEBUG set
+// to 1 and checks the SC_Telemetry frames in it.
+// - PID frames are written out as the text line
+//   {SP_L,CV_L,CO_L,SP_R,CV_R,CO_R,millis} that the library used to print
+//   and the PID.json SerialStudio project expects.
+// - Debug log frames are written out as the SCPRINT string followed by the
+//   value, the same as the library used to print. The strings are found by
+//   working out the hash of every SCPRINT string in the source files.
+// All the other bytes in the stream (CLI text) are copied through unchanged.
+// Gaps in the frame sequence numbers (frames dropped by the vehicle) and
+// frames that fail the CRC check are counted and reported on stderr.
+//
+// Usage: SmartCar_Telemetry [-c] [-s src_dir]... [device [baud]]
+//   -c             only check that the SCPRINT strings all have different hashes,
+//                  exit status 1 if they do not. Run by the Makefile after linking.
+//   -s             also read SCPRINT strings from the source files in this folder.
+//                  The library source (../../src) is always read.
+//   device         serial port or file to read (default is stdin).
+//   baud           set the serial port to this baud rate, raw mode (default 57600).
+//
+
+#include <SC_Telemetry.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <dirent.h>
+#include <map>
+#include <string>
+
+const char LIB_SRC[] = "../../src";   ///< library source relative to extras/host
+
+std::map<uint16_t, std::string> logText;  // SCPRINT strings by hash
+uint16_t logCollisions = 0;               // different strings with the same hash
+
+uint32_t frameCount = 0;        // valid frames decoded
+uint32_t frameDropped = 0;      // frames missing from the sequence
+uint32_t frameBad = 0;          // frames that failed the CRC check
+bool firstFrame = true;         // no sequence number seen yet
+uint8_t lastSeq;                // sequence number of the last frame
+
+uint8_t frame[SC_Telemetry::FRAME_MAX];   // frame being collected
+uint8_t frameLen = 0;                     // bytes collected
+
+// ------------------------------------
+// SCPRINT string dictionary
+
+bool isSource(const char* name)
+{
+  const char* ext = strrchr(name, '.');
+
+  return(ext != nullptr && (strcmp(ext, ".cpp") == 0 || strcmp(ext, ".h") == 0 || strcmp(ext, ".ino") == 0));
+}
+
+const char* readString(const char* p, std::string& s)
+// Read the C string literal starting at p (the opening quote) into s,
+// processing the escape sequences. Returns the next character or nullptr
+// if it is not a complete literal.
+{
+  s.clear();
+  if (*p++ != '"')
+    return(nullptr);
+
+  while (*p != '"')
+  {
+    if (*p == '\0' || *p == '\n')
+      return(nullptr);
+    if (*p == '\\')
+    {
+      p++;
+      switch (*p)
+      {
+      case 'n':  s += '\n'; break;
+      case 't':  s += '\t'; break;
+      case 'r':  s += '\r'; break;
+      case '\0': return(nullptr);
+      default:   s += *p; break;   // \" \\ \'
+      }
+    }
+    else
+      s += *p;
+    p++;
+  }
+
+  return(p + 1);
+}
+
+void readSource(const char* path)
+// Add the string from every SCPRINT, SCPRINTX and SCPRINTS in the file
+{
+  FILE* f = fopen(path, "r");
+  char line[512];
+
+  if (f == nullptr)
+    return;
+
+  while (fgets(line, sizeof(line), f) != nullptr)
+  {
+    const char* p = line;
+
+    while ((p = strstr(p, "SCPRINT")) != nullptr)
+    {
+      std::string s;
+      uint16_t id;
+
+      p += strlen("SCPRINT");
+      if (*p == 'X' || *p == 'S') p++;
+      if (*p++ != '(') continue;
+      while (*p == ' ') p++;
+      if (readString(p, s) == nullptr) continue;    // the macro definitions
+
+      id = SC_Telemetry::hash(s.c_str());
+      if (logText.count(id) != 0 && logText[id] != s)
+      {
+        std::string a, b;   // printable copies
+
+        for (char c : logText[id]) a += (c == '\n' ? std::string("\\n") : std::string(1, c));
+        for (char c : s) b += (c == '\n' ? std::string("\\n") : std::string(1, c));
+        fprintf(stderr, "Hash collision %04x in %s: \"%s\" and \"%s\"\n", id, path, a.c_str(), b.c_str());
+        logCollisions++;
+      }
+      logText[id] = s;
+    }
+  }
+  fclose(f);
+}
+
+void readSourceDir(const char* dir)
+{
+  DIR* d = opendir(dir);
+  struct dirent* e;
+
+  if (d == nullptr)
+  {
+    fprintf(stderr, "Cannot read source folder %s\n", dir);
+    return;
+  }
+
+  while ((e = readdir(d)) != nullptr)
+    if (isSource(e->d_name))
+      readSource((std::string(dir) + "/" + e->d_name).c_str());
+  closedir(d);
+}
+
+// ------------------------------------
+// Frame decoding
+
+bool setBaud(int fd, uint32_t baud)
+// Set the serial port to raw mode at the baud rate
+{
+  static const struct { uint32_t baud; speed_t speed; } speedTable[] =
+  {
+    { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 },
+    { 115200, B115200 }, { 230400, B230400 },
+  };
+  struct termios tio;
+
+  if (tcgetattr(fd, &tio) != 0)
+    return(false);
+  cfmakeraw(&tio);
+  for (uint8_t i = 0; i < sizeof(speedTable)/sizeof(speedTable[0]); i++)
+    if (speedTable[i].baud == baud)
+    {
+      cfsetispeed(&tio, speedTable[i].speed);
+      cfsetospeed(&tio, speedTable[i].speed);
+      return(tcsetattr(fd, TCSANOW, &tio) == 0);
+    }
+
+  return(false);
+}
+
+void printRecord(const SC_Telemetry::record_t& r)
+// Same text format as the old library PID_TUNE output
+{
+  putchar('{');
+  for (uint8_t i = 0; i < SC_Telemetry::MAX_CHANNEL; i++)
+  {
+    if (i != 0) putchar(',');
+    printf("%d,%d,%d", r.sp[i], r.cv[i], r.co[i]);
+  }
+  printf(",%u}\n", r.time);
+}
+
+void printLog(SC_Telemetry::logType_t type, uint16_t id, uint32_t v)
+// Same text as the old library SCPRINT output
+{
+  if (logText.count(id) != 0)
+    fputs(logText[id].c_str(), stdout);
+  else
+    printf("<%04x>", id);
+
+  switch (type)
+  {
+  case SC_Telemetry::LOG_STR: break;
+  case SC_Telemetry::LOG_INT: printf("%d", (int32_t)v); break;
+  case SC_Telemetry::LOG_UINT: printf("%u", v); break;
+  case SC_Telemetry::LOG_HEX: printf("0x%X", v); break;
+  case SC_Telemetry::LOG_FLOAT:
+    {
+      float f;
+
+      memcpy(&f, &v, sizeof(f));
+      printf("%.2f", f);
+    }
+    break;
+  }
+}
+
+void checkSequence(uint8_t seq)
+{
+  if (!firstFrame)
+    frameDropped += (uint8_t)(seq - lastSeq - 1);
+  firstFrame = false;
+  lastSeq = seq;
+  frameCount++;
+}
+
+void processByte(uint8_t c)
+// Collect frames from the stream, copying anything that is not a frame
+{
+  uint8_t len = 0;
+  bool ok = false;
+
+  frame[frameLen++] = c;
+
+  // wait for enough of the frame to know how long it is
+  if (frameLen == 1 && c == SC_Telemetry::SYNC)
+    return;
+  if (frameLen > 1 && frameLen < 4 && (frame[1] == SC_Telemetry::FRAME_PID || frame[1] == SC_Telemetry::FRAME_LOG))
+    return;
+
+  if (frameLen >= 4)
+    len = SC_Telemetry::frameSize(frame);
+  if (len != 0 && frameLen < len)
+    return;
+
+  if (len != 0 && frame[1] == SC_Telemetry::FRAME_PID)
+  {
+    SC_Telemetry::record_t rec;
+
+    if ((ok = SC_Telemetry::decode(frame, rec)))
+    {
+      checkSequence(rec.seq);
+      printRecord(rec);
+    }
+  }
+  else if (len != 0)
+  {
+    uint8_t seq;
+    SC_Telemetry::logType_t type;
+    uint16_t id;
+    uint32_t v;
+
+    if ((ok = SC_Telemetry::decodeLog(frame, seq, type, id, v)))
+    {
+      checkSequence(seq);
+      printLog(type, id, v);
+    }
+  }
+
+  if (ok)
+    frameLen = 0;
+  else
+  {
+    // not a frame - pass the first byte through and look again at the rest
+    uint8_t n = frameLen;
+
+    if (len != 0) frameBad++;
+    putchar(frame[0]);
+    frameLen = 0;
+    for (uint8_t i = 1; i < n; i++)
+      processByte(frame[i]);
+  }
+}
+
+// ------------------------------------
+int main(int argc, char* argv[])
+{
+  int fd = 0;       // stdin
+  uint8_t buf[256];
+  ssize_t n;
+  int i = 1;
+  bool checkOnly = false;
+
+  if (i < argc && strcmp(argv[i], "-c") == 0)
+  {
+    checkOnly = true;
+    i++;
+  }
+
+  readSourceDir(LIB_SRC);
+  for (; i < argc - 1 && strcmp(argv[i], "-s") == 0; i += 2)
+    readSourceDir(argv[i + 1]);
+
+  if (checkOnly)
+  {
+    fprintf(stderr, "%u log strings, %u hash collisions\n", (unsigned)logText.size(), logCollisions);
+    return(logCollisions == 0 ? 0 : 1);
+  }
+
+  if (i < argc)
+  {
+    fd = open(argv[i], O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+    {
+      fprintf(stderr, "Cannot open %s\n", argv[i]);
+      return(1);
+    }
+    if (isatty(fd) && !setBaud(fd, i + 1 < argc ? strtoul(argv[i + 1], nullptr, 10) : 57600))
+    {
+      fprintf(stderr, "Cannot set up serial port %s\n", argv[i]);
+      return(1);
+    }
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);   // each record goes out as soon as it is complete
+
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    for (ssize_t j = 0; j < n; j++)
+      processByte(buf[j]);
+
+  // anything left over was not a complete frame
+  for (uint8_t j = 0; j < frameLen; j++)
+    putchar(frame[j]);
+
+  fprintf(stderr, "%u frames, %u dropped, %u bad\n", frameCount, frameDropped, frameBad);
+
+  return(0);
+}
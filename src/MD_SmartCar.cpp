@@ -18,6 +18,10 @@ get the vehicle set up:
 -# \ref pageSetupPID
 -# \ref pageSetupControl
 
+Steps 2 to 4 can largely be done automatically by MD_SmartCar::autoCalibrate(), 
+described in \ref pageSetupAuto. The manual steps are still useful to 
+understand what the parameters do and to fine tune the results.
+
 \page pageSetupConstants Measure Physical Constants
 
 An application using the library needs to pass a few physical constants to the 
@@ -120,6 +124,16 @@ setting is a compromise that needs to be fine tuned by experimentation, and shou
 - be lower than a value that creates too much free movement (due to vehicle inertia)
 at the end of the move().
 
+This PWM setting is used when move() is run open loop, which is the default. 
+Closed-loop position control is off by default (MC_POS_KP is 0) and is turned on 
+by setting a position loop gain greater than 0 with MD_SmartCar::setPositionGain(). 
+Each wheel then runs under PID speed control at the move velocity and a position 
+loop slows it into the target count, reversing to correct any overshoot. The gain 
+is the speed in pulses per second for each pulse still to go. A wheel has finished 
+when it has stopped within the move tolerance (MD_SmartCar::setMoveTolerance()) of 
+the target and MD_SmartCar::isMoveComplete() reports when all the wheels have 
+finished. Setting the gain back to 0 reverts to the open loop move().
+
 #### Setting PWM control limits
 
 The control limits are the lowest and highest outputs allowed by the PID controller.
@@ -153,9 +167,14 @@ from EEPROM at any time, especially when changes make the PID tuning worse.
 -# Edit MD_SmartCar.h and change 
    \code #define PID_TUNE 0 \endcode to 
    \code #define PID_TUNE 1 \endcode 
-   This will enable the library to output PID control parameters as JSON data. Once 
-tuning is completed, this defined value should be changed back to 0 to suppress output.
+   This will enable the library to output PID control parameters as compact binary 
+telemetry frames (see \ref pageTelemetry). Once tuning is completed, this defined 
+value should be changed back to 0 to suppress output.
 -# Compile and download the __Calibrate__ sketch with this setting turned on.
+-# Run the SmartCar_Telemetry decoder from the library _extras/host_ folder on 
+the serial port. This converts the binary frames back into the JSON data packets
+SerialStudio expects and passes everything else through, so it can be connected 
+to SerialStudio through a virtual serial port pair or network socket.
 -# Start the SerialStudio application and configure it as shown in the figure below
   - Set the Serial Parameters - COM port and baud rate - in the red highlight box. 
   - Set the JSON file to 'Manual' and choose the _PID.json_ file in the library _src_
@@ -189,6 +208,52 @@ motors if required. In most cases the same PID setup for both motors should be a
 Once you are happy with the performance of the PID control loop, save the parameters to 
 EEPROM.
 
+#### PID Control Period
+The speed control runs every PID period, set by MD_SmartCar::setPIDPeriod() and saved 
+with the other configuration parameters. The PID works with speeds in encoder pulses per 
+second, but the PID parameters are scaled as if the speeds were in pulses per PID period. 
+This means the same parameters give a similar response at any period, although a shorter 
+period will usually allow higher gains and faster correction of disturbances.
+
+By default the speed control is run from MD_SmartCar::run() and the timing depends on how 
+often loop() calls run(). For short PID periods (eg, 5-20ms) the speed control can instead 
+be run from a timer interrupt that calls MD_SmartCar::tick() at the PID period. This is 
+enabled with MD_SmartCar::setTimerTick().
+
+#### Wheel Synchronization
+Each motor has its own PID speed controller, so small differences between the motors 
+will make the vehicle drift off a straight line even when both controllers are, on 
+average, at their set point. The wheel synchronization cross-couples the controllers. 
+Each wheel keeps track of how far it has traveled compared to the distance expected 
+from its set points, and the difference between the wheels is fed back to reduce the 
+speed of the wheel that is ahead and increase the speed of the one behind. This works 
+for any commanded ratio of wheel speeds and is used for both MD_SmartCar::drive() and 
+MD_SmartCar::move() (until the position loop takes over at the end of the move).
+
+The synchronization gain is set with MD_SmartCar::setSyncGain(), in pulses per second 
+for each pulse of difference between the wheels. A gain of 0 turns it off, which is 
+the default (MC_SYNC_KP).
+
+#### Feed-forward
+If the PWM needed for each speed is known, MD_SmartCar::setFeedForward() adds it 
+directly to the PID output so the motor goes straight to about the right speed and the 
+PID only corrects the small residual error (see \ref pagePID). The model for each motor 
+is PWM = Ks + Kv * speed, with speed in pulses per second. Ks and Kv are found by running 
+the motor at 2 PWM settings using the __Calibrate__ sketch and measuring the speed at each. 
+Ks is where the line through the 2 points crosses 0 speed, and Kv is the slope. 
+
+When feed-forward is set the kicker is not used, as the feed-forward includes the PWM 
+needed to start the motor. The PID gains will usually need to be reduced once 
+feed-forward is in use.
+
+#### Derivative Filter and Slew Limit
+The encoder speed is only measured to about 1 pulse in each PID period, and this 
+noise goes through Kd into the motor PWM, so a large Kd or a short PID period can 
+make the PWM chatter. MD_SmartCar::setPIDFilter() sets a low pass filter time 
+constant (in ms) for the derivative part of the speed PID and a limit on how much 
+the PWM can change at each PID step. A filter time constant of 1-2 PID periods is 
+usually enough. Both are off (0) by default (see \ref pagePID).
+
 Next: \ref pageSetupControl
 ____
 
@@ -219,12 +284,149 @@ the vehicle will coast to approximately the right spot. The factor is the fracti
 rotation motion (for example, 0.7 will stop the motion 70% through the required steps).
 
 This parameter set up is a compromise between long rotations (more momentum) and short ones 
-(less momentum). 
+(less momentum). It is only used when move() is run open loop, as closed-loop position control 
+brakes into the target.
 
 #### Checking MD_SmartCar::drive() kicker, MD_SmartCar::move() and PID parameters
 A final check of these parameters in action with the vehicle moving its own weight around. The 
 parameters can be modified from the setup screen of ther AI2 app if they need further tuning.
 
+\page pageSetupAuto Automatic Calibration
+
+MD_SmartCar::autoCalibrate() measures the motors and works out the configuration 
+parameters that would otherwise be found by hand with the __MotorTest__ and 
+__Calibrate__ sketches. Both motors are measured at the same time, running forward, 
+so the wheels should be free to turn (eg, with the vehicle on a stand). The whole 
+process takes 10-20 seconds and runs in the background from MD_SmartCar::run().
+
+For each motor the calibration
+-# Ramps up the PWM from 0 until the motor starts turning. This is the start PWM.
+-# Steps the PWM to the maximum setting, waits for the speed to settle and measures 
+the top speed. The pulses 'lost' while the motor accelerates give the motor time 
+constant.
+-# Steps down to a low PWM setting and measures the speed again. The 2 speeds give 
+the straight line relationship between PWM and speed.
+-# Ramps down the PWM until the motor stops. This is the stall PWM.
+
+The results are used to set
+- the minimum PWM to the highest stall PWM of the motors.
+- the kicker PWM to a little more than the highest start PWM, and the move() PWM a 
+little higher again.
+- the maximum speed (pulses per second) to the top speed of the slowest motor. This 
+replaces the value passed to MD_SmartCar::begin() until the next restart, so the 
+value from MD_SmartCar::getMaxPPS() should be copied into the application.
+- the PID parameters for each motor, worked out from the speed line and time constant 
+so that the speed settles in about the motor time constant or the PID period, 
+whichever is longer.
+- optionally, the feed-forward model for each motor (see \ref pageSetupPID).
+
+The configuration is then saved to EEPROM and MD_SmartCar::isCalibrateComplete() 
+reports that it has finished. If a motor does not start or the measurements don't 
+make sense, the configuration is left unchanged.
+
+In the __Calibrate__ sketch, the 'ca' command runs the calibration and reports the 
+new parameters when it completes.
+
+#### Automatic PID Tuning
+MD_SmartCar::autoTune() finds the speed PID parameters for one motor by running it 
+at a set speed and making it oscillate with the SC_PID relay autotune (see 
+\ref pagePID). The PID parameters are worked out from the size and period of the 
+oscillation with one of the standard tuning rules. The Ziegler-Nichols rules give a 
+fast response with some overshoot and the Tyreus-Luyben rule a slower, more robust 
+response. The motors usually respond faster than the PID period, so the oscillation 
+is mostly set by the PID period rather than the motor and the more aggressive rules 
+can leave the speed hunting. The default 'no overshoot' rule is a good place to start.
+
+This is an alternative to the PID parameters from MD_SmartCar::autoCalibrate(), or 
+a way to check them at a particular speed. The new parameters are used straight 
+away but are not saved until MD_SmartCar::saveConfig() is called. 
+MD_SmartCar::isTuneComplete() reports when each motor has finished.
+
+In the __Calibrate__ sketch, the 'tu' command tunes a motor and reports the new 
+parameters when it completes.
+
+\page pageHostSim Host Build and Simulation
+
+The library can be built and run on a Linux host, with no vehicle attached,
+using the files in the library _extras/host_ folder. This allows the control
+performance of MD_SmartCar::drive(), MD_SmartCar::move() and MD_SmartCar::spin()
+to be regression tested off the robot (eg, in CI).
+
+The host build has 3 parts:
+- Stand-ins for the Arduino core (Arduino.h), EEPROM and MD_PWM. These provide
+  a simulated clock, simulated EEPROM and record the motor controller pin outputs.
+  Simulated time only advances when the simulator moves it, so every run is
+  deterministic and can execute thousands of times faster than real time.
+- The SC_SimPlant class, a differential, skid steer or mecanum drive plant model. It reads the motor
+  controller outputs (PWM and direction pins), integrates a first order model
+  of each motor with static friction and stall thresholds and generates the
+  encoder edges at the exact simulated time they occur. Each edge is delivered
+  through the interrupt attached by SC_MotorEncoder::begin(), so the library
+  code runs exactly as it would on the vehicle. The plant also integrates the
+  true vehicle pose for comparison with what the library thinks is happening.
+- SmartCar_Sim, an application that steps MD_SmartCar::run() through a set of
+  scenarios and reports settling time and tracking error for each.
+
+The folder also has SmartCar_Telemetry (make telemetry), the decoder for the
+PID_TUNE binary telemetry and SCDEBUG log sent by a vehicle (see \ref pageTelemetry).
+
+To build and run the simulation:
+\code
+cd extras/host
+make
+./SmartCar_Sim
+\endcode
+
+SmartCar_Sim options are
+- -q to use quadrature encoders.
+- -p <ms> to set the PID period.
+- -t to run the speed control from a simulated timer interrupt calling MD_SmartCar::tick().
+- -m <%> to make the right motor slower than the left by this percentage.
+- -s <gain> to set the wheel synchronization gain.
+- -l <%/s> to set the motion profile acceleration limit (MD_SmartCar::setMotionProfile()).
+- -g <gain> to set the move() position control gain (MD_SmartCar::setPositionGain()).
+- -f to set the feed-forward for both motors from the simulated motor model.
+- -c to run MD_SmartCar::autoCalibrate() before the scenarios and use the results 
+(with -f, also the measured feed-forward).
+- -d <ms> to set the PID derivative filter time constant.
+- -r <pwm> to set the PID output slew limit in PWM per PID period.
+- -e <%> to set the encoder speed filter alpha gain (MD_SmartCar::setSpeedFilter()).
+- -a <rule> to run MD_SmartCar::autoTune() on both motors at 50% speed with this 
+SC_PID::tuneRule_t rule before the scenarios and use the tuned PID parameters.
+- -i to collect the loop timing statistics (MD_SmartCar::setTimingStats()) and print
+them at the end. Simulated time does not advance inside run(), so only the PID 
+lateness, time between calls and encoder interrupt rate are meaningful.
+- -k to use mecanum wheels and add sideways drive() scenarios (4 motor build only).
+- a number sets the simulated period between calls to MD_SmartCar::run() in microseconds.
+
+The Makefile builds with PID_TUNE and SCDEBUG turned off. Other library
+compile time options can be passed in the usual way (eg, make DEFS=-DSCDEBUG=1, or make SCDEBUG=1).
+The host defaults to the floating point PID and pose calculations, so the AVR 
+fixed point versions are tested with make DEFS="-DPID_FIXED_POINT=1 -DPOSE_FIXED_POINT=1" 
+(after a make clean).
+
+make DEFS=-DSC_MOTOR_COUNT=4 builds SmartCar_Sim for a 4 motor skid steer vehicle 
+(mecanum with -k). SmartCar_Bench is only built for 2 motors.
+
+\section secHostBench Benchmarks
+SmartCar_Bench times the control hot path on the host - MD_SmartCar::run() 
+idle, driving, moving and running RAM and PROGMEM sequences, MD_SmartCar::drive() 
+and SC_PID::compute() with and without the derivative filter, slew limit and 
+feed-forward. The same plant model as SmartCar_Sim runs between the timed calls.
+\code
+cd extras/host
+make bench
+\endcode
+
+Each line shows the mean time per call in ns and, on x86, in CPU cycles from 
+the time stamp counter, with the cost of reading the timers taken off, and the 
+longest single call. SmartCar_Bench options are
+- -n <calls> to set the number of calls timed for each path (default 100000).
+- -p <ms> to set the PID period.
+
+These are host numbers. They are useful for comparing paths and before/after
+a change (eg, fixed against floating point), but they are not AVR cycle counts.
+
 \page pageControlModel Unicycle Control Model
 
 Working out the displacement and velocities of each wheel on a
@@ -269,6 +471,74 @@ ____
 - http:://faculty.salina.k-state.edu/tim/robotics_sg/Control/kinematics/unicycle.html
 - https://www.youtube.com/watch?v=aSwCMK96NOw&list=PLp8ijpvp8iCvFDYdcXqqYU5Ibl_aOqwjr
 
+\page pageDrivetrain Drivetrain Types
+
+By default the library drives a 2 motor differential drive vehicle. Larger 
+chassis with a motor on every wheel are supported by setting SC_MOTOR_COUNT to 
+4 before MD_SmartCar.h is included (eg, as a compiler option, as the Arduino IDE
+does not pass defines from the sketch to the library). This sets 
+MD_SmartCar::MAX_MOTOR, so the arrays for the motors are sized and the motor 
+loops run at compile time, and selects the 4 motor constructor. 
+
+The 4 motor constructor takes the motor and encoder pairs in the order left front, 
+right front, left rear and right rear, and these are the motor numbers (0 to 3) 
+used by the methods that take a motor number. Even numbered motors are on the left. 
+The last parameter is the MD_SmartCar::drivetrain_t type:
+- __SKID_STEER__. All the wheels point forward and the vehicle steers by 
+running each side at a different speed. Both motors on a side are given the same 
+speed by the \ref pageControlModel "unicycle model", so drive(), move(), spin() 
+and action sequences work the same as for a 2 motor vehicle. The wheels have to 
+slide sideways to turn, so the effective base length is usually longer than the 
+distance between the wheels and is best found by testing spin().
+- __MECANUM__. The rollers on the left front and right rear wheels push to the 
+right when the wheel turns forward and the other two push to the left, so as well 
+as the skid steer motions the vehicle can move sideways. The lateral velocity is 
+set by MD_SmartCar::drive(vLinear, vLateral, vAngular), positive to the right, 
+and each wheel speed is the unicycle model speed for its side plus (left front, 
+right rear) or minus (right front, left rear) the lateral speed. A mecanum vehicle 
+turns about the wheel centers and the axle centers together, so the distance 
+between the front and rear axles is passed to MD_SmartCar::begin() and is added 
+to the base length for turning.
+
+The \ref pageOdometry "pose odometry" uses the average travel of the wheels on 
+each side and, for mecanum wheels, adds the sideways travel 
+(d<sub>LF</sub> - d<sub>RF</sub> - d<sub>LR</sub> + d<sub>RR</sub>) / 4 at 
+right angles to the heading. The wheel synchronization (MD_SmartCar::setSyncGain())
+works across all the wheels. The PID telemetry frame only has room for 2 motors,
+so a 4 motor vehicle sends the front pair.
+
+The actionItem_t format and the MD_SmartCar::MOVE parameters (left and right side 
+rotation) do not change with the motor count, so the same sequences run on every 
+drivetrain type.
+
+\page pageOdometry Pose Odometry
+
+The library estimates the vehicle pose (x, y position and heading &theta;) by 
+dead reckoning from the wheel encoders, using the same vehicle constants as 
+the \ref pageControlModel "unicycle model". Every time MD_SmartCar::run() is 
+called the encoder pulses counted by each wheel since the last call 
+(d<sub>L</sub>, d<sub>R</sub>, averaged for each side with 4 motors, see 
+\ref pageDrivetrain) are integrated into the pose:
+- &Delta;&theta; = (d<sub>L</sub> - d<sub>R</sub>) / B
+- &Delta;x = ((d<sub>L</sub> + d<sub>R</sub>) / 2) cos(&theta; + &Delta;&theta;/2)
+- &Delta;y = ((d<sub>L</sub> + d<sub>R</sub>) / 2) sin(&theta; + &Delta;&theta;/2)
+
+where B is the vehicle base length, all in encoder pulses. The heading is 
+positive clockwise, following the library convention.
+
+Single channel encoders do not sense direction, so the pulses are counted in 
+the direction the motor was last commanded to turn. Quadrature encoders 
+give the actual direction of rotation and are more accurate, especially when 
+the vehicle coasts or changes direction.
+
+On AVR processors the pose is integrated in fixed point arithmetic (set by 
+POSE_FIXED_POINT). The position is held in 1/256 pulse units, the heading as 
+a 32 bit binary angle that wraps naturally and the sine and cosine are 
+interpolated from a small table in PROGMEM. Other processors use floating point.
+
+The pose is read with MD_SmartCar::getPose() and set back to the origin 
+with MD_SmartCar::resetPose().
+
 \page pageActionSequence Action Sequences
 
 Action sequences are a way of defining a sequential actions that the library 
@@ -320,10 +590,183 @@ enumerated type MD_SmartCar::actionId_t.
 |  MD_SmartCar::SPIN | executes spin()  | Spin percentage | Not used
 | MD_SmartCar::PAUSE | executes pause   | Milliseconds    | Not used
 |  MD_SmartCar::STOP | executes stop()  | Not used        | Not used
+|  MD_SmartCar::JUMP | continue from item | Item index    | Not used
+| MD_SmartCar::JUMP_IF | JUMP if condition true | Condition id | Item index
+| MD_SmartCar::JUMP_IFNOT | JUMP if condition false | Condition id | Item index
+| MD_SmartCar::REPEAT | loop back to item | Loop count (0 forever) | Item index
+| MD_SmartCar::WAIT_UNTIL | wait for condition true | Condition id | Timeout ms (0 none)
+|  MD_SmartCar::CALL | run sub-sequence | Item index      | Not used
+| MD_SmartCar::RETURN | end sub-sequence | Not used       | Not used
+| MD_SmartCar::LIMIT | failure handling for next item | Time limit ms (0 none) | Item index, SEQ_SKIP or SEQ_ABORT
 |   MD_SmartCar::END | marks seq end    | Not used        | Not used
 
+### Item Storage
+To keep sequences small each item is stored as a one byte action id and two 
+16 bit integer parameters (5 bytes on AVR). The parameters are written as 
+numbers in the usual units and converted by the actionItem_t constructor, which 
+is done by the compiler for sequences declared as constants. The conversion 
+depends on the action:
+- Angles and angular velocities (MOVE and DRIVE parameter 1) are stored in 
+1/100 radian (MD_SmartCar::SEQ_ANGLE_SCALE), so they are limited to +/-327 
+radians and rounded to the nearest 0.01 radian.
+- DRIVE linear velocity and SPIN percentage are stored as whole numbers.
+- Times, counts, item indices and condition ids are stored as unsigned whole 
+numbers [0..65535]. Longer pauses can be made with a REPEAT loop.
+
+Values out of range are limited to the range. While the sequence runs the 
+library reads each item where it is stored, in PROGMEM or RAM, rather than 
+making a copy. The parameters of an item in RAM can be changed with 
+actionItem_t::setParm() and read with actionItem_t::getParm().
+
+### Program Flow
+The sequence is run like a small program, one item every time 
+MD_SmartCar::run() is called (items that wait, like MOVE or PAUSE, are run 
+again until they finish), so it takes a short and predictable time in the 
+background. Items are numbered from 0 at the start of the array and the flow
+control items go to the item with the index given in the parameter:
+- JUMP carries on from the item.
+- JUMP_IF and JUMP_IFNOT carry on from the item if a condition is true (false), 
+otherwise from the next item.
+- REPEAT goes back to the first item of a loop until the loop has run the number 
+of times specified, then carries on from the next item. Loops may be nested up
+to 4 deep.
+- WAIT_UNTIL waits until a condition is true, or the timeout has expired.
+- CALL runs the sub-sequence starting at the item until it reaches a RETURN, and 
+then carries on from the item after the CALL. Sub-sequences are put in the same 
+array, usually after the END, and may CALL other sub-sequences up to 4 deep. A 
+RETURN that is not in a sub-sequence ends the sequence like END.
+
+If the loops or sub-sequences are nested too deep the sequence fails (see below)
+and is ended.
+
+Conditions are tested by functions in the application, registered with an id 
+number using MD_SmartCar::setSequenceCondition(). Each function returns true 
+when its condition is met, usually from the latest sensor readings. For example, 
+a sequence that backs away from an obstacle and turns toward the most open space
+\code
+enum { COND_LEFT_CLEAR };
+
+bool isLeftClear(void) { return(sonarL > sonarR); }
+
+static const PROGMEM MD_SmartCar::actionItem_t seq[] =
+{
+  { MD_SmartCar::STOP },                  // 0
+  { MD_SmartCar::MOVE,  -PI, -PI },       // 1
+  { MD_SmartCar::JUMP_IF, COND_LEFT_CLEAR, 5 },  // 2
+  { MD_SmartCar::SPIN,  25 },             // 3
+  { MD_SmartCar::END },                   // 4
+  { MD_SmartCar::SPIN,  -25 },            // 5
+  { MD_SmartCar::END }                    // 6
+};
+
+Car.setSequenceCondition(COND_LEFT_CLEAR, isLeftClear);   // in setup()
+\endcode
+The condition functions are called from MD_SmartCar::run(), so they must be short.
+
+### Failures
+An item fails when it runs for longer than its time limit, or when it is a MOVE 
+or SPIN and a wheel times out (the move fails, see \ref pageEvents). By default 
+the vehicle is stopped, the failure is reported and the sequence carries on 
+with the next item. A LIMIT item sets the time limit and what happens when 
+the item straight after it fails:
+- SEQ_SKIP carries on with the next item.
+- SEQ_ABORT ends the sequence.
+- Any other value is the index of the item to carry on from, usually the start
+of a recovery sub-sequence.
+
+For example, a move that must finish in 800 milliseconds or the vehicle backs out
+\code
+  { MD_SmartCar::LIMIT, 800, 7 },         // 3
+  { MD_SmartCar::MOVE,  PI, PI },         // 4
+\endcode
+A sequence that nests loops or sub-sequences too deep is always ended.
+
+The reason for the last failure (MD_SmartCar::seqFail_t) is returned by 
+MD_SmartCar::getSequenceFailure() and is also reported with the EV_SEQ_FAIL 
+event. It is reset to SEQ_FAIL_NONE when a sequence is started.
+
+### Sequence Priority
+MD_SmartCar::startSequence() always replaces whatever sequence is running. 
+Applications that run different sequences for different behaviors (eg, 
+escape from a collision, avoid an obstacle, follow a wall) can instead give 
+each a priority with MD_SmartCar::queueSequence() and let the library decide 
+which one runs:
+- A sequence with a higher priority than the running sequence preempts it
+straight away. The vehicle is stopped and the new sequence started.
+- A sequence with the same or lower priority waits in a queue if it was 
+queued with the SEQ_RESUME policy, or is dropped with SEQ_DISCARD.
+- A preempted sequence also waits in the queue if it was queued with 
+SEQ_RESUME, or is dropped with SEQ_DISCARD. When it resumes, the item that 
+was interrupted is run again from the start.
+- When the running sequence ends, the highest priority sequence in the queue 
+is run. Sequences with the same priority run in the order they were queued.
+
+Queuing a sequence that is already running or waiting does nothing, so the 
+application can simply queue a sequence every time it sees the condition that 
+triggers it
+\code
+if (Sensors.bumperL || Sensors.bumperR)
+  Car.queueSequence(seqEscape, PRIO_ESCAPE);
+\endcode
+Up to MD_SmartCar::SEQ_QUEUE_SIZE sequences can wait in the queue. When it 
+is full the newest of the lowest priority sequences is dropped to make room 
+for one with a higher priority. The size is set by defining SC_SEQ_QUEUE_SIZE
+before the library is compiled (default 1). Each place in the queue, like the 
+running sequence, takes 32 bytes of RAM on AVR. MD_SmartCar::stop() and 
+MD_SmartCar::startSequence() empty the queue, and MD_SmartCar::isSequenceComplete() 
+is only true when the running sequence has ended and the queue is empty.
+
+\page pageEvents Motion Events
+
+## Motion Events
+
+Instead of polling isRunning(), isMoveComplete() or isSequenceComplete() 
+every time through loop(), the application can be told when things happen. 
+MD_SmartCar::run() records each event with the millis() time it happened in 
+an MD_SmartCar::event_t:
+
+| eventId_t       | When                                                 | Data
+|:----------------|:-----------------------------------------------------|:-----
+| EV_MOVE_DONE    | a move() or spin() has all the wheels at the target  | -
+| EV_MOVE_FAILED  | a move() or spin() ended after a wheel timed out     | -
+| EV_MOVE_TIMEOUT | a wheel saw no encoder pulses for 2 seconds during a move() and was turned off | motor number
+| EV_STALL        | a wheel saw no encoder pulses for 2 seconds while driven by drive() (repeated every 2 seconds while it stays stalled) | motor number
+| EV_SEQ_STEP     | an action sequence started an item                   | item index
+| EV_SEQ_DONE     | an action sequence ended                             | sequence priority
+| EV_SEQ_FAIL     | an action sequence item failed                       | seqFail_t reason
+
+Moves, sequences or drive() that are stopped or replaced do not raise an event.
+
+The events can be handled in two ways:
+- Register a callback with MD_SmartCar::setEventCallback(). The callback is 
+called for each event at the end of run(), once the library has finished 
+its own work, so it can safely start another motion or sequence.
+- Read the events with MD_SmartCar::getEvent(). The last 
+MD_SmartCar::EVENT_QUEUE_SIZE events are kept, the oldest being dropped if 
+they are not read in time.
+
+Events wait in the same queue for the callback, which empties it at the end 
+of every run(). The queue holds SC_EVENT_QUEUE_SIZE events, 6 bytes of RAM 
+each on AVR. The default is the number of motors plus 4, enough for all the 
+events one run() can raise. It can be changed by defining SC_EVENT_QUEUE_SIZE 
+before the library is compiled.
+
+\code
+void carEvent(const MD_SmartCar::event_t& ev)
+{
+  if (ev.id == MD_SmartCar::EV_MOVE_DONE)
+    Car.spin(25);
+}
+
+Car.setEventCallback(carEvent);   // in setup()
+\endcode
 */
 
+#if PID_TUNE || SCDEBUG
+SC_Telemetry SCTelemetry;
+#endif
+
+#if SC_MOTOR_COUNT == 2
 MD_SmartCar::MD_SmartCar(SC_DCMotor *ml, SC_MotorEncoder *el, SC_DCMotor *mr, SC_MotorEncoder *er)
 {
   // Allocate the pointer to the right array reference
@@ -331,15 +774,62 @@ MD_SmartCar::MD_SmartCar(SC_DCMotor *ml, SC_MotorEncoder *el, SC_DCMotor *mr, SC
   _M[MRIGHT] = mr;
   _E[MLEFT] = el;
   _E[MRIGHT] = er;
+  _drivetrain = DIFFERENTIAL;
+
+  _timerTick = false;
+  _moveActive = _moveComplete = false;
+  _calActive = _calComplete = false;
+  _tuneComplete = 0;
+  _statsOn = false;
+  for (uint8_t i = 0; i < SEQ_CONDITIONS; i++)
+    _seqCond[i] = nullptr;
+  _inSequence = _inSeqItem = false;
+  _seqQueued = 0;
+  _seqFailure = SEQ_FAIL_NONE;
+  _evCallback = nullptr;
+  _evHead = _evCount = 0;
 }
+#else
+MD_SmartCar::MD_SmartCar(SC_DCMotor* mlf, SC_MotorEncoder* elf, SC_DCMotor* mrf, SC_MotorEncoder* erf,
+                         SC_DCMotor* mlr, SC_MotorEncoder* elr, SC_DCMotor* mrr, SC_MotorEncoder* err,
+                         drivetrain_t type)
+{
+  // Allocate the pointer to the right array reference
+  _M[MLEFT] = mlf;
+  _M[MRIGHT] = mrf;
+  _M[MLEFT_REAR] = mlr;
+  _M[MRIGHT_REAR] = mrr;
+  _E[MLEFT] = elf;
+  _E[MRIGHT] = erf;
+  _E[MLEFT_REAR] = elr;
+  _E[MRIGHT_REAR] = err;
+  _drivetrain = (type == MECANUM ? MECANUM : SKID_STEER);
+
+  _timerTick = false;
+  _moveActive = _moveComplete = false;
+  _calActive = _calComplete = false;
+  _tuneComplete = 0;
+  _statsOn = false;
+  for (uint8_t i = 0; i < SEQ_CONDITIONS; i++)
+    _seqCond[i] = nullptr;
+  _inSequence = _inSeqItem = false;
+  _seqQueued = 0;
+  _seqFailure = SEQ_FAIL_NONE;
+  _evCallback = nullptr;
+  _evHead = _evCount = 0;
+}
+#endif
 
 MD_SmartCar::~MD_SmartCar(void) 
 {
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
     delete _mData[i].pid;
+    delete _mData[i].pidPos;
+  }
 }
 
-bool MD_SmartCar::begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase)
+bool MD_SmartCar::begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase, uint16_t lAxle)
 // Return false if any of the encoders fail to begin
 { 
   bool b = true;
@@ -351,7 +841,11 @@ bool MD_SmartCar::begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
   {
     _mData[i].pid = new SC_PID(&_mData[i].cv, &_mData[i].co, &_mData[i].sp, _config.Kp[i], _config.Ki[i], _config.Kd[i]);
-    _mData[i].pid->setPIDPeriod(PID_PERIOD);
+    _mData[i].pidPos = new SC_PID(&_mData[i].posCv, &_mData[i].posCo, &_mData[i].posSp, _config.posKp, 0.0, 0.0, 0.0);
+    _mData[i].pidPos->setOutputLimits(-INT16_MAX, INT16_MAX);  // speed is limited by runPID()
+    _mData[i].posSp = 0;
+    setPIDParameters(i);
+    _mData[i].direction = SC_DCMotor::DIR_FWD;
     _mData[i].state = S_IDLE;
   }
   setPIDOutputLimits();
@@ -364,9 +858,14 @@ bool MD_SmartCar::begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t
   }
 
   // Set up default environment
-  setVehicleParameters(ppr, ppsMax, dWheel, lBase);
+  setVehicleParameters(ppr, ppsMax, dWheel, lBase, lAxle);
   stop();    // initialize to all stop
 
+  // start odometry from here
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    _E[i]->snapshot(_mData[i].odo);
+  resetPose();
+
   return(b);
 }
 
@@ -374,8 +873,18 @@ void MD_SmartCar::run(void)
 // run the FSM to manage motor functions
 {
   const uint32_t MOVE_TIMEOUT = 2000;   // ms
+  const uint32_t MOVE_SETTLE = 200;     // ms with no pulses for a wheel to be stopped
   bool firstPass = true;
   uint32_t now = millis();      // keep time in sync for all motors in the loop
+  uint32_t tStart = _statsOn ? micros() : 0;
+
+  // keep track of where we are
+  updatePose();
+
+#if PID_TUNE || SCDEBUG
+  // send any telemetry and debug log without waiting for the Serial port
+  SCTelemetry.drain();
+#endif
 
   // run the sequence to set up a command if we are currently in that mode
   if (_inSequence)
@@ -391,14 +900,20 @@ void MD_SmartCar::run(void)
     // --- FREE RUNNING
     case S_DRIVE_INIT:
       SCPRINT("\n>>DRIVE_INIT #", motor);
-      if (_mData[motor].sp < getKickerSP())  // motor setpoint less than kicker PWM, so use kicker
+      _mData[motor].prof.reset();     // starting from standstill
+      _mData[motor].vel.reset();
+      // Feed-forward gets the motor started, otherwise always use the 
+      // kicker from a standing start, as the PID output starts from it.
+      if (!isFeedForward(motor))
       {
         _M[motor]->run(_mData[motor].direction, getKickerSP()); // start at kicker PWM
+        _mData[motor].co = getKickerSP();   // PID continues from here
         _mData[motor].timeLast = now; // use this temporarily
         _mData[motor].state = S_DRIVE_KICKER;
       }
       else   // no need for kicker as speed this is already higher
       {
+        _mData[motor].co = 0;
         _mData[motor].timeLast = now - _mData[motor].pid->getPIDPeriod();
         _mData[motor].state = S_DRIVE_PIDRST;
       }
@@ -417,120 +932,362 @@ void MD_SmartCar::run(void)
       _mData[motor].pid->setMode(SC_PID::USER);
       _mData[motor].pid->reset();
       _E[motor]->reset();   // reset the counters
-      _mData[motor].timeLast = now;
+      _E[motor]->snapshot(_mData[motor].enc);   // start of wheel synchronization
+      _mData[motor].pos = 0;
+      _mData[motor].posRef = _mData[motor].lag = _mData[motor].lagLast = 0.0;
+      _mData[motor].posLoop = false;
+      _mData[motor].timeLast = now - _mData[motor].pid->getPIDPeriod();  // first PID step straight away
+      _mData[motor].timeMove = now;   // stall watchdog
       _mData[motor].state = S_DRIVE_RUN;
       break;
       
     case S_DRIVE_RUN:
-      if (now - _mData[motor].timeLast >= _mData[motor].pid->getPIDPeriod())
+      // when timer driven, tick() runs the PID
+      if (!_timerTick && (now - _mData[motor].timeLast >= _mData[motor].pid->getPIDPeriod()))
+        runPID(motor, now, firstPass);
+
+      // The PID step resets the watchdog when the wheel turns, so it times
+      // out if a wheel that should be turning has stalled. The event is
+      // repeated every MOVE_TIMEOUT while it stays stalled.
       {
-        uint32_t time;      // time for encoder accumulator
-        uint16_t cv;        // current encoder value
-
-        // Print Tuning parameters if this is the first pass.
-        // Only enabled with PID_TUNE set to 1.
-        // This actually prints the results of the last pass but should be good 
-        // enough to see what is happening during tuning.
-        if (firstPass)
+        bool stalled = false;
+
+        noInterrupts();     // tick() may be resetting the watchdog
+        if (millis() - _mData[motor].timeMove >= MOVE_TIMEOUT)
         {
-          P_PID_HDR;
-          for (uint8_t i = 0; i < MAX_MOTOR; i++)
-            P_PID_BODY(_mData[i].sp, _mData[i].cv, _mData[i].co, (i == MAX_MOTOR-1));
-          P_PID_TAIL;
+          _mData[motor].timeMove = millis();
+          stalled = true;
         }
-
-        // run the PID loop to keep things on even keel
-        _E[motor]->read(time, cv, true);   // read and reset the encoder counter
-        _mData[motor].cv = cv;             // save the current value for PID
-        _mData[motor].pid->compute();      // run PID next step
-        _M[motor]->run(_mData[motor].direction, _mData[motor].co); // set motor speed
-        _mData[motor].timeLast = now;    // set the processed time marker identical for all motors
-
-        // debug print to see what happening
-        if (firstPass)   // only print the header info once each loop iteration
+        interrupts();
+        if (stalled)
         {
-          firstPass = false;
-          SCPRINT("\nPID ", time);
-          SCPRINTS("ms ");
+          SCPRINT("\nDRIVE stall #", motor);
+          raiseEvent(EV_STALL, motor);
         }
-        else
-          SCPRINTS(",");
-        SCPRINT(" [", motor);
-        SCPRINT("] SP:", _mData[motor].sp);
-        SCPRINT(" CV:", _mData[motor].cv);
-        SCPRINT(" CO:", _mData[motor].co);
       }
       break;
 
     // --- Precision moves
     case S_MOVE_INIT:
       SCPRINT("\n>>MOVE_INIT #", motor);
-      _E[motor]->reset();
-      _M[motor]->run(_mData[motor].direction, _mData[motor].sp);
-      _mData[motor].timeLast = now;   // watchdog timer for moves
+      SCPRINT(" target ", _mData[motor].target);
+      _E[motor]->snapshot(_mData[motor].enc);
+      _mData[motor].pos = 0;
+      _mData[motor].posRef = _mData[motor].lag = _mData[motor].lagLast = 0.0;
+      _mData[motor].timeMove = now;   // watchdog timer for moves
+      _mData[motor].posLoop = false;
+      if (isProfiled() || isPosControl())
+      {
+        // start at kicker PWM, or the feed-forward, and PID speed control from there
+        _mData[motor].prof.reset();
+        _mData[motor].vel.reset();
+        _mData[motor].sp = 0;
+        _mData[motor].co = startSP(motor);
+        _mData[motor].pid->setMode(SC_PID::USER);
+        _mData[motor].pid->reset();
+        _E[motor]->reset();
+        _M[motor]->run(_mData[motor].direction, _mData[motor].co);
+        _mData[motor].timeLast = isFeedForward(motor) ? now - _mData[motor].pid->getPIDPeriod() : now;
+      }
+      else
+        _M[motor]->run(_mData[motor].direction, _mData[motor].sp);
       _mData[motor].state = S_MOVE_RUN;
-      // deliberately fall through
+      // fall through
 
     case S_MOVE_RUN:
+    case S_MOVE_HOLD:
       {
         uint32_t time;
-        uint16_t count;
-
-        // Read pulses and if we got something, reset the watchdog
-        _E[motor]->read(time, count, false);
-        if (count != 0) _mData[motor].timeLast = now;
-
-        if (firstPass)
+        int32_t count;
+        int32_t d;
+
+        // Read pulses and if we got something, reset the watchdog.
+        _E[motor]->readDelta(_mData[motor].enc, count, time);
+        if (count != 0) _mData[motor].timeMove = now;
+        _mData[motor].pos += fwdDirection(motor, count);
+        d = moveRemaining(motor);
+
+        // Only log the wheels that moved, as this runs every time through
+        // and would soon fill the telemetry buffer.
+        firstPass = false;
+        if (count != 0)
         {
-          firstPass = false;
-          SCPRINTS("\nMOVE");
+          SCPRINT("\nMOVE [", motor);
+          SCPRINT("] ", _mData[motor].pos);
         }
-        else
-          SCPRINTS(",");
-        SCPRINT(" [", motor); 
-        SCPRINT("] ", count);
-        SCPRINT("/", _mData[motor].cv);
         
         // check for ending conditions
-        if (((int16_t)count >= _mData[motor].cv) ||               // done all the pulses required
-           (millis() - _mData[motor].timeLast >= MOVE_TIMEOUT))   // watchdog timed out!
+        if (millis() - _mData[motor].timeMove >= MOVE_TIMEOUT)  // watchdog timed out!
         {
           _M[motor]->setSpeed(0);
           _mData[motor].state = S_IDLE;
+          _moveFailed = true;
+          raiseEvent(EV_MOVE_TIMEOUT, motor);
+        }
+        else if (!isPosControl())
+        {
+          if (d <= 0)     // done all the pulses required
+          {
+            _M[motor]->setSpeed(0);
+            _mData[motor].state = S_IDLE;
+          }
+          else if (isProfiled() && (now - _mData[motor].timeLast >= _mData[motor].pid->getPIDPeriod()))
+            runPID(motor, now, firstPass);
         }
+        else if (abs(d) <= _config.moveTolerance)
+        {
+          // Close enough - turn the motor off and wait for the wheel to stop.
+          // It is done if it stays inside the tolerance.
+          if (_mData[motor].state == S_MOVE_RUN)
+          {
+            _mData[motor].sp = _mData[motor].co = 0;
+            _M[motor]->setSpeed(0);
+            _mData[motor].state = S_MOVE_HOLD;
+          }
+          else if (now - _mData[motor].timeMove >= MOVE_SETTLE)
+            _mData[motor].state = S_IDLE;
+        }
+        else if (_mData[motor].state == S_MOVE_HOLD)
+        {
+          // coasted out of tolerance, so start up again to correct it
+          _mData[motor].vel.reset();
+          _mData[motor].co = startSP(motor);
+          _mData[motor].pid->reset();
+          _mData[motor].timeLast = now - _mData[motor].pid->getPIDPeriod();
+          _mData[motor].state = S_MOVE_RUN;
+        }
+        else if (now - _mData[motor].timeLast >= _mData[motor].pid->getPIDPeriod())
+          runPID(motor, now, firstPass);
       }
       break;
 
+    // --- Automatic calibration
+    case S_CAL_START:
+    case S_CAL_HIGH:
+    case S_CAL_LOW:
+    case S_CAL_STALL:
+      runCalibrate(motor, now);
+      break;
+
+    case S_TUNE_INIT:
+    case S_TUNE_RUN:
+      runTune(motor, now);
+      break;
+
     default: _mData[motor].state = S_IDLE; break;
     }
   }
+
+  // raise the completion event once all the wheels have finished a move
+  if (_moveActive && !isRunning())
+  {
+    _moveActive = false;
+    _moveComplete = !_moveFailed;
+    SCPRINT("\nMOVE done ", _moveComplete);
+    raiseEvent(_moveFailed ? EV_MOVE_FAILED : EV_MOVE_DONE);
+  }
+
+  // finish off once all the motors are calibrated and idle
+  if (_calActive && !isRunning())
+  {
+    _calActive = false;
+    if (!_calFailed) calibrateDone();
+    _calComplete = !_calFailed;
+    SCPRINT("\nCALIBRATE done ", _calComplete);
+  }
+
+  if (_statsOn)
+    statsRun(tStart);
+
+  // report the events once all the work is done, so the callback
+  // can start new motions
+  if (_evCallback != nullptr)
+  {
+    event_t ev;
+
+    while (getEvent(ev))
+      _evCallback(ev);
+  }
+}
+
+void MD_SmartCar::tick(void)
+// Run the speed control for all the motors, normally called from a timer ISR
+{
+  bool firstPass = true;
+  uint32_t now = millis();
+
+  if (!_timerTick)
+    return;
+
+  for (uint8_t motor = 0; motor < MAX_MOTOR; motor++)
+    if (_mData[motor].state == S_DRIVE_RUN)
+      runPID(motor, now, firstPass);
 }
 
-void MD_SmartCar::drive(int8_t vLinear, float vAngularR)
+void MD_SmartCar::runPID(uint8_t motor, uint32_t now, bool& firstPass)
+// Run one PID speed control step for the specified motor
 {
-  float spL, spR;
+  float dt = (float)_mData[motor].pid->getPIDPeriod() / (float)MS_PER_SEC;
+  int16_t pps;        // current encoder speed (fixed point)
+  float v;            // motion profile velocity
+
+#if PID_TUNE
+  // Buffer the tuning telemetry if this is the first pass.
+  // This actually sends the results of the last pass but should be good 
+  // enough to see what is happening during tuning. run() sends it on.
+  // Speeds are sent as whole pps. With 4 motors only the front pair
+  // fits in the frame.
+  if (firstPass)
+  {
+    SC_Telemetry::record_t r;
+    const int16_t HALF = 1 << (SPEED_FX_BITS - 1);
+
+    r.time = now;
+    for (uint8_t i = 0; i < SC_Telemetry::MAX_CHANNEL && i < MAX_MOTOR; i++)
+    {
+      r.sp[i] = (_mData[i].sp + HALF) >> SPEED_FX_BITS;
+      r.cv[i] = (_mData[i].cv + HALF) >> SPEED_FX_BITS;
+      r.co[i] = _mData[i].co;
+    }
+    SCTelemetry.write(r);
+  }
+#endif
+
+  // Work out the next set point from the motion profile. 
+  // The drive() set point is signed and the motor direction follows it 
+  // as the profile changes speed.
+  // Moves slow down to stop at the target. Once the position loop speed 
+  // is lower than the profile, the position loop takes over to brake into 
+  // the target, reversing if the wheel has gone past it.
+  if (_mData[motor].state == S_MOVE_RUN)
+  {
+    int32_t d = moveRemaining(motor);
+
+    v = _mData[motor].prof.next(_mData[motor].spTarget, dt, d);
+    if (isPosControl())
+    {
+      _mData[motor].posCv = constrain(-d, -INT16_MAX, INT16_MAX);
+      if (!_mData[motor].posLoop && (_config.posKp * d < v))
+      {
+        _mData[motor].posCo = constrain(_config.posKp * d, -INT16_MAX, INT16_MAX);
+        _mData[motor].pidPos->setMode(SC_PID::USER);
+        _mData[motor].pidPos->reset();    // bumpless start from here
+        _mData[motor].posLoop = true;
+      }
+      if (_mData[motor].posLoop)
+      {
+        _mData[motor].pidPos->compute();
+        if (_mData[motor].posCo < v) v = _mData[motor].posCo;
+        if (v < -_mData[motor].spTarget) v = -_mData[motor].spTarget;
+      }
+    }
+    if (_mData[motor].target < 0) v = -v;   // make it relative to forward
+  }
+  else
+  {
+    uint32_t time;
+    int32_t count;
+
+    _E[motor]->readDelta(_mData[motor].enc, count, time);   // drive() travel
+    _mData[motor].pos += fwdDirection(motor, count);
+    if (count != 0 || _mData[motor].spTarget == 0)   // stall watchdog
+      _mData[motor].timeMove = now;
+    v = _mData[motor].prof.next(_mData[motor].spTarget, dt);
+  }
+
+  // Wheel synchronization. Each wheel tracks how far it is ahead of the 
+  // travel expected from its set points and the difference to the other 
+  // wheels is used to correct the set point. The lag is measured in the 
+  // wheel's direction of travel, so wheels turning in opposite directions
+  // (eg, spin() or a mecanum sideways drive()) are compared properly. 
+  // This is not used once the position loop is bringing the wheels into 
+  // the end of a move().
+  {
+    float vSync = v;
+    float dir = (v < 0.0 ? -1.0 : 1.0);
+    bool posLoop = false;
+
+    for (uint8_t i = 0; i < MAX_MOTOR; i++)
+      posLoop = posLoop || _mData[i].posLoop;
+
+    if (_config.syncKp != 0.0 && !posLoop)
+    {
+      vSync -= dir * syncCorrection(motor, now);
+      if (v * vSync < 0.0) vSync = 0.0;   // never reverse the wheel
+    }
+    _mData[motor].lagLast = _mData[motor].lag;
+    _mData[motor].lag = dir * ((float)_mData[motor].pos - _mData[motor].posRef);
+    _mData[motor].posRef += v * dt;
+    v = vSync;
+  }
+
+  // Motor direction follows the set point, unchanged when it is 0
+  if (v != 0.0)
+  {
+    SC_DCMotor::runCmd_t dir = (v < 0.0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
 
-  if (vLinear == 0)
+    if (dir != _mData[motor].direction)   // restart PID from low output for reversal
+    {
+      _mData[motor].direction = dir;
+      _mData[motor].co = 0;
+      _mData[motor].vel.reset(-_mData[motor].vel.getVelocity());  // now against the direction
+      _mData[motor].pid->reset();
+    }
+  }
+  _mData[motor].sp = constrain(fabs(v) * (1 << SPEED_FX_BITS) + 0.5, 0, INT16_MAX);
+
+  // run the PID loop to keep things on even keel
+  // Encoder speed is in fixed point pulses per second, negative if the 
+  // wheel is turning against the commanded direction, and smoothed by
+  // the speed filter.
+  pps = cmdDirection(motor, _E[motor]->readSpeed(true, SPEED_FX_BITS));  // read speed and reset the encoder counter
+  _mData[motor].cv = _mData[motor].vel.update(pps);
+  _mData[motor].pid->compute();      // run PID next step
+  _M[motor]->run(_mData[motor].direction, _mData[motor].co); // set motor speed
+  if (_statsOn) statsPID(motor, now);
+  _mData[motor].timeLast = now;    // set the processed time marker identical for all motors
+
+  // debug print to see what happening
+  // Kept short so one step for all the motors fits in the telemetry buffer.
+  if (firstPass)   // only print the header info once each loop iteration
+  {
+    firstPass = false;
+    SCPRINT("\nPID ", now);
+  }
+  SCPRINT(" [", motor);
+  SCPRINT("] SP:", (double)_mData[motor].sp / (1 << SPEED_FX_BITS));
+  SCPRINT(" CV:", (double)_mData[motor].cv / (1 << SPEED_FX_BITS));
+  SCPRINT(" CO:", _mData[motor].co);
+}
+
+void MD_SmartCar::drive(int8_t vLinear, int8_t vLateral, float vAngularR)
+{
+  float spL, spR, spLat;
+
+  if (_drivetrain != MECANUM)
+    vLateral = 0;   // only mecanum wheels can move sideways
+
+  if (vLinear == 0 && vLateral == 0)
     stop();
-  else if ((vLinear == _vLinear) && (vAngularR == _vAngular))
+  else if ((vLinear == _vLinear) && (vLateral == _vLateral) && (vAngularR == _vAngular))
     return;    // no change
   else
   {
     SCPRINT("\n** DRIVE v:", vLinear);
+    SCPRINT(" l:", vLateral);
     SCPRINT(" a:", vAngularR);
 
     // sanitize input
     if (vLinear < -100) vLinear = -100;
     if (vLinear > 100) vLinear = 100;
+    if (vLateral < -100) vLateral = -100;
+    if (vLateral > 100) vLateral = 100;
     if (vAngularR < -PI/2) vAngularR = -PI/2;
     if (vAngularR > PI/2)  vAngularR = PI/2;
 
-    // decompose and save as current global settings
-    _mData[MLEFT].direction = (vLinear < 0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
-    _mData[MRIGHT].direction = _mData[MLEFT].direction;
-    
     // save these for reporting/other use
     _vLinear = vLinear;
+    _vLateral = vLateral;
     _vAngular = vAngularR;
     
     // set up for calculations
@@ -559,44 +1316,93 @@ void MD_SmartCar::drive(int8_t vLinear, float vAngularR)
     SCPRINT(" -> pps L:", spL);
     SCPRINT(" R:", spR);
 
-    // Convert the pps velocity into encoder pulses per PID period
-    // PulsePerPIDPeriod = PulsePerSecond/PID_FREQUENCY
-    spL /= PID_FREQ;
-    spR /= PID_FREQ;
-    SCPRINT(" -> PID SPL:", spL);
-    SCPRINT(" SPR:", spR);
-
-    // put values into the motor setpoint parameters (integers) for running the FSM
-    _mData[MLEFT].sp = trunc(spL + 0.5);
-    _mData[MRIGHT].sp = trunc(spR + 0.5);
-    _mData[MLEFT].state = _mData[MRIGHT].state = (isRunning() ? S_DRIVE_PIDRST : S_DRIVE_INIT);
+    // Put values into the motor target speeds (pps, signed for the 
+    // direction) for running the FSM. The motion profile ramps the PID set 
+    // point to these. Interrupts are off as tick() may be using these.
+    if (_vLinear < 0)
+    {
+      spL = -spL;
+      spR = -spR;
+    }
+
+    // Mecanum wheels add the sideways motion. The rollers on the left 
+    // front and right rear wheels push to the right when the wheel turns 
+    // forward and the other two push to the left, so moving right turns 
+    // those wheels forward and the others in reverse.
+    spLat = ((float)_ppsMax * _vLateral) / 100.0;
+    SCPRINT(" Lat:", spLat);
+
+    noInterrupts();
+    _moveActive = false;
+    _calActive = false;
+    for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    {
+      _mData[i].spTarget = (isLeft(i) ? spL : spR);
+      if (_drivetrain == MECANUM)
+        _mData[i].spTarget += (i == MLEFT || i == MRIGHT_REAR) ? spLat : -spLat;
+    }
+    if (isRunning())
+    {
+      for (uint8_t i = 0; i < MAX_MOTOR; i++)
+        _mData[i].state = S_DRIVE_PIDRST;
+    }
+    else
+    {
+      for (uint8_t i = 0; i < MAX_MOTOR; i++)
+      {
+        _mData[i].direction = (_mData[i].spTarget < 0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
+        _mData[i].state = S_DRIVE_INIT;
+      }
+    }
+    interrupts();
   }
 }
 
 void MD_SmartCar::move(float angL, float angR)
 {
+  SC_DCMotor::runCmd_t dirL, dirR;
+  int32_t pulseL, pulseR;
+
   SCPRINT("\n** MOVE L:", angL);
   SCPRINT(" R:", angR);
 
   // set the motor direction
-  _mData[MLEFT].direction = (angL < 0.0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
-  _mData[MRIGHT].direction = (angR < 0.0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
+  dirL = (angL < 0.0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
+  dirR = (angR < 0.0 ? SC_DCMotor::DIR_REV : SC_DCMotor::DIR_FWD);
   if (angL < 0.0) angL = -angL;   // absolute value
   if (angR < 0.0) angR = -angR;   // absolute value
 
-  // set the motor PWM setpoint
-  _mData[MLEFT].sp = _mData[MRIGHT].sp = getMoveSP();
-  SCPRINT("\nMove PWM L ", _mData[MLEFT].sp);
-  SCPRINT(" R ", _mData[MRIGHT].sp);
-
   // convert subtended angle into number of encoder pulses
-  _mData[MLEFT].cv = trunc((angL * _ppr) / (2.0 * PI));
-  _mData[MRIGHT].cv = trunc((angR * _ppr) / (2.0 * PI));
-  SCPRINT("; Pulses L ", _mData[MLEFT].cv);
-  SCPRINT(" R ", _mData[MRIGHT].cv);
-
-  // finally, set it up for the FSM to execute
-  _mData[MLEFT].state = _mData[MRIGHT].state = S_MOVE_INIT;
+  pulseL = trunc((angL * _ppr) / (2.0 * PI));
+  pulseR = trunc((angR * _ppr) / (2.0 * PI));
+  SCPRINT("\nMove PWM ", getMoveSP());
+  SCPRINT("; Pulses L ", pulseL);
+  SCPRINT(" R ", pulseR);
+
+  // finally, set it up for the FSM to execute with the move PWM setpoint
+  // or the move velocity for closed-loop moves.
+  // Interrupts are off as tick() may be using these.
+  noInterrupts();
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    if (isLeft(i))
+    {
+      _mData[i].direction = dirL;
+      _mData[i].target = (dirL == SC_DCMotor::DIR_REV ? -pulseL : pulseL);
+    }
+    else
+    {
+      _mData[i].direction = dirR;
+      _mData[i].target = (dirR == SC_DCMotor::DIR_REV ? -pulseR : pulseR);
+    }
+    _mData[i].sp = getMoveSP();
+    _mData[i].spTarget = ((float)_config.moveVelocity * _ppsMax) / 100.0;
+    _mData[i].state = S_MOVE_INIT;
+  }
+  _moveActive = true;
+  _moveFailed = _moveComplete = false;
+  _calActive = false;
+  interrupts();
 }
 
 void MD_SmartCar::spin(int16_t fraction)
@@ -623,7 +1429,10 @@ void MD_SmartCar::spin(int16_t fraction)
   // Wheel_fraction = (base_length_in_pulses * fraction)/wheel_diameter_in_pulses.
   // 
   // Wheel_fraction then converted to wheel rotation angle in radians.
-  float angle = 2.0 * PI * (fraction / 100.0) * (_lenBaseP / _diaWheelP) * _config.spinAdjust;
+  float angle = 2.0 * PI * (fraction / 100.0) * (_lenBaseP / _diaWheelP);
+
+  if (!isProfiled() && !isPosControl())   // closed-loop moves stop at the target
+    angle *= _config.spinAdjust;
   SCPRINT(" wheel angle ", angle);
 
   move(dirL * angle, dirR * angle);
@@ -633,72 +1442,156 @@ void MD_SmartCar::stop(void)
 // totally halt the vehicle
 {
   _vLinear = 0;
+  _vLateral = 0;
   _vAngular = 0.0;
-  _inSequence = false;
+  if (!_inSeqItem)    // STOP and DRIVE items only halt the vehicle
+  {
+    _inSequence = false;
+    _seqQueued = 0;
+  }
+  _moveActive = false;
+  _calActive = false;
 
+  noInterrupts();     // tick() may be using the motors
+  // The direction is left unchanged so that odometry counts
+  // any coasting the right way.
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
   {
-    _mData[i].direction = SC_DCMotor::DIR_FWD;
     _mData[i].sp = 0;
     _mData[i].state = S_IDLE;
+    _mData[i].pid->stopTune();
     _M[i]->run(_mData[i].direction, _mData[i].sp);
   }
+  interrupts();
 }
 
-bool MD_SmartCar::runActionItem(actionItem_t &ai)
+bool MD_SmartCar::runActionItem(void)
+// The item is read in place from the sequence, converting only the
+// parameters used by the action.
 {
-  switch (ai.opId)
+  uint8_t op = seqOpId();
+
+  switch (op)
   {
   case DRIVE:
-    SCPRINT("\nSEQ: drive(", ai.parm[0]);
-    SCPRINT(", ", ai.parm[1]);
+    SCPRINT("\nSEQ: drive(", seqParm(0));
+    SCPRINT(", ", (float)seqParm(1) / SEQ_ANGLE_SCALE);
     SCPRINTS(")");
-    drive(ai.parm[0], ai.parm[1]);
-    _inSequence = true;     // in case speed was 0 and stop() was invoked, we need to re-set this on
+    drive((int8_t)seqParm(0), (float)seqParm(1) / SEQ_ANGLE_SCALE);
     _inAction = false;
     break;
 
   case MOVE:
     if (!_inAction)
     {
-      SCPRINT("\nSEQ: move(", ai.parm[0]);
-      SCPRINT(", ", ai.parm[1]);
+      SCPRINT("\nSEQ: move(", (float)seqParm(0) / SEQ_ANGLE_SCALE);
+      SCPRINT(", ", (float)seqParm(1) / SEQ_ANGLE_SCALE);
       SCPRINTS(")");
-      move(ai.parm[0], ai.parm[1]);
+      move((float)seqParm(0) / SEQ_ANGLE_SCALE, (float)seqParm(1) / SEQ_ANGLE_SCALE);
       _inAction = true;
     }
     else
-      _inAction = isRunning();
+    {
+      _inAction = _moveActive;    // until all the wheels have finished
+      if (!_inAction && _moveFailed)
+        seqFail(SEQ_FAIL_STALL);
+    }
     break;
 
   case SPIN:
     if (!_inAction)
     {
-      SCPRINT("\nSEQ: spin(", (int16_t)ai.parm[0]);
+      SCPRINT("\nSEQ: spin(", seqParm(0));
       SCPRINTS(")");
-      spin((int16_t)ai.parm[0]);
+      spin(seqParm(0));
       _inAction = true;
     }
     else 
-      _inAction = isRunning();
+    {
+      _inAction = _moveActive;
+      if (!_inAction && _moveFailed)
+        seqFail(SEQ_FAIL_STALL);
+    }
     break;
 
   case PAUSE:
     if (!_inAction)
     {
-      SCPRINT("\nSEQ: pause(", (uint32_t) ai.parm[0]);
+      SCPRINT("\nSEQ: pause(", (uint16_t)seqParm(0));
       SCPRINTS(")");
-      _timeStartSeq = millis();
       _inAction = true;
     }
     else 
-      _inAction = (millis() - _timeStartSeq < ai.parm[0]);
+      _inAction = (millis() - _timeStartSeq < (uint16_t)seqParm(0));
     break;
 
   case STOP:
     SCPRINTS("\nSEQ: stop()");
     stop();
-    _inSequence = true;   // stop() sets this false but we need it on for sequences to work!
+    _inAction = false;
+    break;
+
+  case JUMP:
+    SCPRINT("\nSEQ: jump ", (uint8_t)seqParm(0));
+    seqJump((uint8_t)seqParm(0));
+    _inAction = false;
+    break;
+
+  case JUMP_IF:
+  case JUMP_IFNOT:
+    {
+      bool b = isSeqCondition((uint8_t)seqParm(0));
+
+      SCPRINT("\nSEQ: condition ", (uint8_t)seqParm(0));
+      SCPRINT(" = ", b);
+      if (b == (op == JUMP_IF))
+        seqJump((uint8_t)seqParm(1));
+      _inAction = false;
+    }
+    break;
+
+  case REPEAT:
+    SCPRINT("\nSEQ: repeat ", (uint16_t)seqParm(0));
+    seqRepeat((uint16_t)seqParm(0), (uint8_t)seqParm(1));
+    _inAction = false;
+    break;
+
+  case WAIT_UNTIL:
+    if (!_inAction)
+    {
+      SCPRINT("\nSEQ: wait until ", (uint8_t)seqParm(0));
+    }
+    _inAction = !isSeqCondition((uint8_t)seqParm(0)) && 
+                (seqParm(1) == 0 || millis() - _timeStartSeq < (uint16_t)seqParm(1));
+    break;
+
+  case CALL:
+    SCPRINT("\nSEQ: call ", (uint8_t)seqParm(0));
+    if (_seq.callDepth >= SEQ_CALL_DEPTH)
+      seqFail(SEQ_FAIL_DEPTH);
+    else
+    {
+      _seq.call[_seq.callDepth++] = _seq.item;
+      _seq.item = (uint8_t)seqParm(0);
+    }
+    _inAction = false;
+    break;
+
+  case RETURN:
+    SCPRINT("\nSEQ: return, depth ", _seq.callDepth);
+    if (_seq.callDepth == 0)     // not in a sub-sequence, so this is the end
+      _inSequence = false;
+    else
+      _seq.item = _seq.call[--_seq.callDepth];
+    _inAction = false;
+    break;
+
+  case LIMIT:
+    SCPRINT("\nSEQ: limit ", (uint16_t)seqParm(0));
+    SCPRINT(" fail ", (uint8_t)seqParm(1));
+    _seq.limit = (uint16_t)seqParm(0);
+    _seq.onFail = (uint8_t)seqParm(1);
+    _seq.limitItem = _seq.item;     // the next item
     _inAction = false;
     break;
 
@@ -712,6 +1605,94 @@ bool MD_SmartCar::runActionItem(actionItem_t &ai)
   return(_inAction);
 }
 
+void MD_SmartCar::seqJump(uint8_t target)
+// Loops are left when a jump goes outside them
+{
+  while (_seq.loopDepth > 0 && 
+         (target < _seq.loop[_seq.loopDepth - 1].start || target > _seq.loop[_seq.loopDepth - 1].item))
+    _seq.loopDepth--;
+
+  _seq.item = target;
+}
+
+void MD_SmartCar::seqRepeat(uint16_t count, uint8_t target)
+// The loop has already run once when the REPEAT is first reached, so 
+// it goes back count-1 times. The loop counts are kept on a stack 
+// so that loops can be nested.
+{
+  uint8_t item = _seq.item - 1;   // this REPEAT item
+  int8_t i;
+
+  if (count == 0)   // forever
+  {
+    _seq.item = target;
+    return;
+  }
+
+  // find this loop if it is already running
+  for (i = _seq.loopDepth - 1; i >= 0; i--)
+    if (_seq.loop[i].item == item)
+      break;
+
+  if (i < 0)    // just got here for the first time
+  {
+    if (count == 1)
+      return;
+    if (_seq.loopDepth >= SEQ_LOOP_DEPTH)
+    {
+      seqFail(SEQ_FAIL_DEPTH);
+      return;
+    }
+    i = _seq.loopDepth;
+    _seq.loop[i].start = target;
+    _seq.loop[i].item = item;
+    _seq.loop[i].count = count - 1;
+  }
+
+  _seq.loopDepth = i + 1;    // any loops inside this one are finished
+  if (_seq.loop[i].count == 0)
+    _seq.loopDepth = i;      // done, carry on after the loop
+  else
+  {
+    _seq.loop[i].count--;
+    _seq.item = target;
+  }
+}
+
+void MD_SmartCar::seqFail(seqFail_t reason)
+// The vehicle is halted and the sequence carries on as set by the 
+// LIMIT for this item. Without a LIMIT it carries on with the next item.
+{
+  uint8_t target = SEQ_SKIP;
+
+  if (reason == SEQ_FAIL_DEPTH)
+    target = SEQ_ABORT;
+  else if (_seq.item - 1 == _seq.limitItem)
+    target = _seq.onFail;
+
+  SCPRINT("\nSEQ: fail ", reason);
+  SCPRINT(" -> ", target);
+  _seqFailure = reason;
+  raiseEvent(EV_SEQ_FAIL, reason);
+
+  stop();     // only halts the vehicle as this is run from a sequence item
+  _inAction = false;
+  _seq.limitItem = SEQ_NO_ITEM;
+  if (target == SEQ_ABORT)
+    _inSequence = false;
+  else if (target != SEQ_SKIP)
+    seqJump(target);
+}
+
+bool MD_SmartCar::setSequenceCondition(uint8_t id, seqCondition_t fn)
+{
+  if (id >= SEQ_CONDITIONS)
+    return(false);
+
+  _seqCond[id] = fn;
+  return(true);
+}
+
 void MD_SmartCar::startSequence(const actionItem_t* actionList)
 {
   if (actionList == nullptr)
@@ -720,8 +1701,11 @@ void MD_SmartCar::startSequence(const actionItem_t* actionList)
   SCPRINTS("\nSEQ: startSequence PROGMEM");
 
   // initialise for a new run
-  _seqIsConstant = true;
-  _uAction.cp = actionList;
+  _seqQueued = 0;
+  _seq.isConstant = true;
+  _seq.list = actionList;
+  _seq.priority = 0;
+  _seq.policy = SEQ_DISCARD;
 
   startSeqCommon();
 }
@@ -734,35 +1718,209 @@ void MD_SmartCar::startSequence(actionItem_t* actionList)
   SCPRINTS("\nSEQ: startSequence RAM");
 
   // initialise for a new run
-  _seqIsConstant = false;
-  _uAction.p = actionList;
+  _seqQueued = 0;
+  _seq.isConstant = false;
+  _seq.list = actionList;
+  _seq.priority = 0;
+  _seq.policy = SEQ_DISCARD;
 
   startSeqCommon();
 }
 
 void MD_SmartCar::startSeqCommon(void)
 {
-  _curActionItem = 0;
+  _seq.item = 0;
+  _seq.callDepth = 0;
+  _seq.loopDepth = 0;
+  _seq.limitItem = SEQ_NO_ITEM;
+  _seqFailure = SEQ_FAIL_NONE;
   _inSequence = true;
   _inAction = false;
 
   runSequence();    // do the first step
 }
 
+bool MD_SmartCar::queueSequence(const actionItem_t* actionList, uint8_t priority, seqPolicy_t policy)
+{
+  SCPRINT("\nSEQ: queueSequence PROGMEM ", priority);
+  return(queueSeqCommon(actionList, true, priority, policy));
+}
+
+bool MD_SmartCar::queueSequence(actionItem_t* actionList, uint8_t priority, seqPolicy_t policy)
+{
+  SCPRINT("\nSEQ: queueSequence RAM ", priority);
+  return(queueSeqCommon(actionList, false, priority, policy));
+}
+
+bool MD_SmartCar::queueSeqCommon(const actionItem_t* actionList, bool isConstant, uint8_t priority, seqPolicy_t policy)
+// Run the sequence now if it has a higher priority than the running 
+// sequence, otherwise queue or drop it depending on the policy.
+{
+  seqState_t sq;
+
+  if (actionList == nullptr)
+    return(false);
+
+  // nothing to do if it is already running or waiting
+  if (_inSequence && _seq.list == actionList)
+    return(true);
+  for (uint8_t i = 0; i < _seqQueued; i++)
+    if (_seqQueue[i].list == actionList)
+      return(true);
+
+  sq.list = actionList;
+  sq.isConstant = isConstant;
+  sq.priority = priority;
+  sq.policy = policy;
+  sq.item = 0;
+  sq.callDepth = 0;
+  sq.loopDepth = 0;
+  sq.limitItem = SEQ_NO_ITEM;
+
+  if (_inSequence && priority <= _seq.priority)
+  {
+    if (policy == SEQ_RESUME)
+      return(seqSave(sq, false));
+
+    SCPRINTS("\nSEQ: dropped");
+    return(false);
+  }
+
+  if (_inSequence)
+  {
+    // Preempt the running sequence. If it is resumed the interrupted 
+    // item is run again from the start.
+    SCPRINT("\nSEQ: preempt ", _seq.priority);
+    if (_inAction)
+      _seq.item--;
+    if (_seq.policy == SEQ_RESUME)
+      seqSave(_seq, true);
+    _inSeqItem = true;    // halt the vehicle but keep the queue
+    stop();
+    _inSeqItem = false;
+  }
+
+  _seq = sq;
+  startSeqCommon();
+
+  return(true);
+}
+
+bool MD_SmartCar::seqSave(const seqState_t& sq, bool first)
+// Sequences are resumed in priority order and, for the same priority,
+// in the order they are in the queue. A preempted sequence goes at
+// the front so it resumes before any of the same priority that were 
+// waiting for it. If the queue is full the newest of the lowest 
+// priority sequences is dropped to make room, if it is lower than this.
+{
+  uint8_t n = _seqQueued;   // local copy so the compiler can see the bounds
+
+  if (n >= SEQ_QUEUE_SIZE)
+  {
+    uint8_t low = 0;
+
+    n = SEQ_QUEUE_SIZE;
+    for (uint8_t i = 1; i < n; i++)
+      if (_seqQueue[i].priority <= _seqQueue[low].priority)
+        low = i;
+
+    if (_seqQueue[low].priority >= sq.priority)
+    {
+      SCPRINTS("\nSEQ: queue full, dropped");
+      return(false);
+    }
+
+    SCPRINT("\nSEQ: queue full, dropped ", _seqQueue[low].priority);
+    n--;
+    for (uint8_t i = low; i < n; i++)
+      _seqQueue[i] = _seqQueue[i + 1];
+  }
+
+  if (first)
+  {
+    for (uint8_t i = n; i > 0; i--)
+      _seqQueue[i] = _seqQueue[i - 1];
+    _seqQueue[0] = sq;
+  }
+  else
+    _seqQueue[n] = sq;
+  _seqQueued = n + 1;
+
+  return(true);
+}
+
+void MD_SmartCar::seqResume(void)
+{
+  uint8_t queued = (_seqQueued < SEQ_QUEUE_SIZE ? _seqQueued : SEQ_QUEUE_SIZE) - 1;  // after this one is taken
+  uint8_t n = 0;
+
+  for (uint8_t i = 1; i <= queued; i++)
+    if (_seqQueue[i].priority > _seqQueue[n].priority)
+      n = i;
+
+  _seq = _seqQueue[n];
+  for (uint8_t i = n; i < queued; i++)
+    _seqQueue[i] = _seqQueue[i + 1];
+  _seqQueued = queued;
+
+  SCPRINT("\nSEQ: resume ", _seq.priority);
+  _inSequence = true;
+  _inAction = false;
+}
+
 void MD_SmartCar::runSequence(void)
 {
   // If executing a sequence, work with action items
   if (_inSequence)
   {
-    if (!_inAction)   // not currently doing anything, load next action item
+    if (!_inAction)   // not currently doing anything, move to the next action item
     {
-      if (_seqIsConstant)
-        memcpy_P(&_ai, &_uAction.cp[_curActionItem], sizeof(actionItem_t));
-      else
-        memcpy(&_ai, &_uAction.p[_curActionItem], sizeof(actionItem_t));
-      _curActionItem++;
+      raiseEvent(EV_SEQ_STEP, _seq.item);
+      if (_seq.item != _seq.limitItem)    // a LIMIT only applies to the item after it
+        _seq.limitItem = SEQ_NO_ITEM;
+      _timeStartSeq = millis();
+      _ai = &_seq.list[_seq.item++];
     }
 
-    runActionItem(_ai);   // process current action
+    _inSeqItem = true;
+    runActionItem();      // process current action
+    if (_inAction && _seq.item - 1 == _seq.limitItem &&
+        _seq.limit != 0 && millis() - _timeStartSeq >= _seq.limit)
+      seqFail(SEQ_FAIL_TIMEOUT);
+    _inSeqItem = false;
+
+    if (!_inSequence)
+    {
+      raiseEvent(EV_SEQ_DONE, _seq.priority);
+      if (_seqQueued > 0)   // carry on with the next waiting
+        seqResume();
+    }
   }
 }
+
+void MD_SmartCar::raiseEvent(uint8_t id, uint8_t data)
+// The queue keeps the newest events, dropping the oldest when full
+{
+  event_t& ev = _evQueue[(_evHead + _evCount) % EVENT_QUEUE_SIZE];
+
+  ev.id = id;
+  ev.data = data;
+  ev.time = millis();
+
+  if (_evCount < EVENT_QUEUE_SIZE)
+    _evCount++;
+  else
+    _evHead = (_evHead + 1) % EVENT_QUEUE_SIZE;
+}
+
+bool MD_SmartCar::getEvent(event_t& ev)
+{
+  if (_evCount == 0)
+    return(false);
+
+  ev = _evQueue[_evHead];
+  _evHead = (_evHead + 1) % EVENT_QUEUE_SIZE;
+  _evCount--;
+
+  return(true);
+}
@@ -50,10 +50,17 @@ The library is designed to control 2 types of autonomous movements:
 - \subpage pageUsingLibrary
 - \subpage pageHardwareMap
 - \subpage pageControlModel
+- \subpage pageDrivetrain
+- \subpage pageOdometry
 - \subpage pageActionSequence
+- \subpage pageEvents
 - \subpage pagePID
+- \subpage pageMotionProfile
+- \subpage pageVelocityEstimator
+- \subpage pageTelemetry
 - \subpage pageMotorController
 - \subpage pageMotorEncoder
+- \subpage pageHostSim
 
 ### Additional Topics
 - \subpage pageRevisionHistory
@@ -86,6 +93,34 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 \page pageRevisionHistory Revision History
+Oct 2026 Version 1.2.0
+- Added host (Linux) build and simulator in extras/host
+- Encoder pulse edge timestamps and combined period/count speed measurement
+- Encoder counter is free running and read through atomic snapshots so no pulses are lost
+- Added SC_MotorEncoderQuad quadrature encoder with direction sensing
+- PID period is a configuration parameter and speed control can be run from a timer interrupt
+- Added pose odometry with getPose() and resetPose()
+- Added optional trapezoidal and S-curve motion profiles for drive(), move() and spin()
+- Optional closed-loop position control for move() and spin() with isMoveComplete() event
+- Optional cross-coupled wheel synchronization for drive() and move()
+- Per motor feed-forward in SC_PID, replacing the drive() kicker when set
+- Added autoCalibrate() to measure the motors and set up the configuration
+- Added relay autotuning to SC_PID and autoTune() for the motor speed PID
+- SC_PID derivative filter, output slew limit and back-calculation anti-windup
+- SC_PID compute() is all fixed point on AVR (PID_FIXED_POINT, PID_FX_BITS)
+- Added SmartCar_Bench host benchmarks for the control hot path
+- PID_TUNE output is buffered binary telemetry (SC_Telemetry) with the SmartCar_Telemetry host decoder
+- SCDEBUG output is logged as tokenized binary records through the same buffer
+- Loop timing statistics (setTimingStats(), getTimingStats(), resetTimingStats())
+- Speed PID works in fixed point pulses per second (SPEED_FX_BITS) with an optional alpha-beta speed filter (setSpeedFilter())
+- 4 motor skid steer and mecanum drivetrains (SC_MOTOR_COUNT, drivetrain_t) with sideways drive() for mecanum
+- Wheel synchronization compares wheels in their own direction of travel
+- Action sequence flow control (JUMP, JUMP_IF, JUMP_IFNOT, REPEAT, WAIT_UNTIL, CALL, RETURN) with conditions registered by setSequenceCondition()
+- Action items are packed into 5 bytes with scaled integer parameters and are read in place while a sequence runs
+- Prioritized action sequence queue with preemption (queueSequence(), getSequencePriority()), size set by SC_SEQ_QUEUE_SIZE
+- Motion, stall and sequence events with timestamps (setEventCallback(), getEvent()), queue size set by SC_EVENT_QUEUE_SIZE
+- Action sequence LIMIT items set a time limit and failure handling for the next item (getSequenceFailure())
+
 Aug 2021 Version 1.1.0
 - Improved & corrected spin() algorithm
 - Updated and corrected documentation
@@ -105,6 +140,8 @@ Apr 2021 version 1.0.0
 #include <SC_DCMotor.h>
 #include <SC_MotorEncoder.h>
 #include <SC_PID.h>
+#include <SC_MotionProfile.h>
+#include <SC_VelocityEstimator.h>
 
  /**
  * \file
@@ -112,35 +149,49 @@ Apr 2021 version 1.0.0
  */
 
 #ifndef PID_TUNE
-#define PID_TUNE 1    ///< set to 1 for specific PID tuning output
+#define PID_TUNE 1    ///< set to 1 for binary PID tuning telemetry output
 #endif
 #ifndef SCDEBUG
-#define SCDEBUG  0    ///< set to 1 for general debug output
+#define SCDEBUG  0    ///< set to 1 for general debug log output
 #endif
-
-#if SCDEBUG
-#define SCPRINT(s,v)   do { Serial.print(F(s)); Serial.print(v); } while (false)
-#define SCPRINTX(s,v)  do { Serial.print(F(s)); Serial.print(F("0x")); Serial.print(v, HEX); } while (false)
-#define SCPRINTS(s)    do { Serial.print(F(s)); } while (false)
+#include <SC_Telemetry.h>   // after PID_TUNE and SCDEBUG, which set the buffer size
+#ifndef POSE_FIXED_POINT
+#ifdef __AVR__
+#define POSE_FIXED_POINT 1  ///< set to 1 for fixed point pose odometry (default for AVR)
 #else
-#define SCPRINT(s,v)
-#define SCPRINTX(s,v)
-#define SCPRINTS(s)
+#define POSE_FIXED_POINT 0  ///< set to 1 for fixed point pose odometry (default for AVR)
+#endif
+#endif
+#ifndef SC_MOTOR_COUNT
+#define SC_MOTOR_COUNT 2    ///< number of drive motors, 2 (differential) or 4 (skid steer, mecanum)
+#endif
+#if SC_MOTOR_COUNT != 2 && SC_MOTOR_COUNT != 4
+#error "SC_MOTOR_COUNT must be 2 or 4"
+#endif
+#ifndef SC_SEQ_QUEUE_SIZE
+#define SC_SEQ_QUEUE_SIZE 1     ///< number of sequences that can wait to run, 32 bytes of RAM each on AVR
+#endif
+#ifndef SC_EVENT_QUEUE_SIZE
+#define SC_EVENT_QUEUE_SIZE (SC_MOTOR_COUNT + 4)  ///< number of events kept for getEvent(), 6 bytes of RAM each on AVR
+#endif
+#if SC_SEQ_QUEUE_SIZE < 1 || SC_EVENT_QUEUE_SIZE < 1
+#error "SC_SEQ_QUEUE_SIZE and SC_EVENT_QUEUE_SIZE must be at least 1"
 #endif
 
-#if PID_TUNE
-#define P_PID_HDR   do { Serial.print(F("{")); } while (false)
-#define P_PID_BODY(SP, CV, CO, last) do \
-{ \
-  Serial.print(SP); Serial.print(F(",")); \
-  Serial.print(CV); Serial.print(F(",")); \
-  Serial.print(CO); if (!last) Serial.print(F(",")); \
-} while (false)
-#define P_PID_TAIL do { Serial.print(F(",")); Serial.print(millis()); Serial.print(F("}\n")); } while (false)
+#if PID_TUNE || SCDEBUG
+extern SC_Telemetry SCTelemetry;  ///< buffered telemetry and debug log output (see \ref pageTelemetry)
+#endif
+
+// Debug output is logged as the compile time hash of the string plus the 
+// raw value and turned back into text by the host decoder.
+#if SCDEBUG
+#define SCPRINT(s,v)   do { enum : uint16_t { id = SC_Telemetry::hash(s) }; SCTelemetry.log(id, v); } while (false)
+#define SCPRINTX(s,v)  do { enum : uint16_t { id = SC_Telemetry::hash(s) }; SCTelemetry.logHex(id, v); } while (false)
+#define SCPRINTS(s)    do { enum : uint16_t { id = SC_Telemetry::hash(s) }; SCTelemetry.log(id); } while (false)
 #else
-#define P_PID_HDR
-#define P_PID_BODY(SP, CV, CO, last)
-#define P_PID_TAIL
+#define SCPRINT(s,v)   do {} while (false)
+#define SCPRINTX(s,v)  do {} while (false)
+#define SCPRINTS(s)    do {} while (false)
 #endif
 
 #ifndef ARRAY_SIZE
@@ -160,9 +211,22 @@ public:
   /**
     * Maximum number of motors
     *
-    * Define the maximum number of motors that this library can control
+    * Define the maximum number of motors that this library can control.
+    * Set at compile time by SC_MOTOR_COUNT (see \ref pageDrivetrain).
     */
-  static const uint8_t MAX_MOTOR = 2;
+  static const uint8_t MAX_MOTOR = SC_MOTOR_COUNT;
+
+  /**
+   * Enumerated type for the drivetrain
+   *
+   * Specifies how the motors move the vehicle (see \ref pageDrivetrain).
+   */
+  enum drivetrain_t
+  {
+    DIFFERENTIAL, ///< one motor each side (2 motors)
+    SKID_STEER,   ///< front and rear motors each side, steered by speed difference (4 motors)
+    MECANUM,      ///< mecanum wheels that can also move sideways (4 motors)
+  };
 
   /**
    * Enumerated type for Action Items operation
@@ -171,24 +235,177 @@ public:
    */
   enum actionId_t
   {
-    DRIVE,    ///< executes drive(); param 0 lin vel, param 1 angular velocity
-    MOVE,     ///< executes a move(); param 0 left rotate, param 1 right rotate
-    SPIN,     ///< executes a spin(); param 0 spin percentage
-    PAUSE,    ///< executes a pause; param 0 milliseconds pause
-    STOP,     ///< executes a stop()
-    END       ///< marks the end of the action list; should always be last item.
+    DRIVE,      ///< executes drive(); param 0 lin vel, param 1 angular velocity
+    MOVE,       ///< executes a move(); param 0 left rotate, param 1 right rotate
+    SPIN,       ///< executes a spin(); param 0 spin percentage
+    PAUSE,      ///< executes a pause; param 0 milliseconds pause
+    STOP,       ///< executes a stop()
+    JUMP,       ///< continues from another item; param 0 item index
+    JUMP_IF,    ///< JUMP if a condition is true; param 0 condition id, param 1 item index
+    JUMP_IFNOT, ///< JUMP if a condition is false; param 0 condition id, param 1 item index
+    REPEAT,     ///< loops back to an item; param 0 number of times to run the loop (0 forever), param 1 item index
+    WAIT_UNTIL, ///< waits for a condition to be true; param 0 condition id, param 1 timeout in milliseconds (0 none)
+    CALL,       ///< runs a sub-sequence until RETURN; param 0 item index
+    RETURN,     ///< returns from a sub-sequence to the item after the CALL
+    LIMIT,      ///< sets failure handling for the next item; param 0 time limit in milliseconds (0 none), param 1 on failure item index, SEQ_SKIP or SEQ_ABORT
+    END         ///< marks the end of the action list; should always be last item.
+  };
+
+  /**
+   * Sequence condition function
+   *
+   * A function registered with setSequenceCondition() that returns true 
+   * when a condition tested by an action sequence is met (eg, a sensor 
+   * reading is over a threshold). It is called from run(), so it must be 
+   * short and must not start another sequence.
+   */
+  typedef bool (*seqCondition_t)(void);
+
+  static const uint8_t SEQ_CONDITIONS = 8;  ///< number of sequence conditions that can be registered
+  static const uint8_t SEQ_QUEUE_SIZE = SC_SEQ_QUEUE_SIZE;  ///< number of sequences that can wait behind the running sequence
+  static const uint8_t SEQ_SKIP = 254;      ///< LIMIT on failure, carry on with the next item
+  static const uint8_t SEQ_ABORT = 255;     ///< LIMIT on failure, end the sequence
+
+  /**
+   * Enumerated type for sequence failures
+   *
+   * Specifies why an action sequence item failed (see \ref pageActionSequence).
+   */
+  enum seqFail_t
+  {
+    SEQ_FAIL_NONE,    ///< no failure
+    SEQ_FAIL_TIMEOUT, ///< the item took longer than the LIMIT time
+    SEQ_FAIL_STALL,   ///< a wheel stopped turning during a MOVE or SPIN
+    SEQ_FAIL_DEPTH,   ///< CALL or REPEAT nested too deep, the sequence is always ended
+  };
+
+  /**
+   * Enumerated type for sequence queue policy
+   *
+   * Specifies what happens to a sequence given to queueSequence() when 
+   * a higher priority sequence is running or preempts it.
+   */
+  enum seqPolicy_t
+  {
+    SEQ_DISCARD,  ///< the sequence is dropped
+    SEQ_RESUME,   ///< the sequence waits in the queue and runs when the higher priority sequences are done
   };
   
+  static const uint8_t SEQ_ANGLE_SCALE = 100;  ///< action item angles are stored in 1/SEQ_ANGLE_SCALE radians
+
   /**
     * Move sequence item definition
     * 
-    * Define one of the action elements for a move() sequence.
+    * Define one of the action elements for a move() sequence. The parameters
+    * are stored as 16 bit integers, scaled for each action (see 
+    * \ref pageActionSequence), so an item takes 5 bytes on AVR. Items are 
+    * initialized with floating point parameters as { action, parm0, parm1 }, 
+    * which are converted by the compiler for sequences defined as constants.
     */
-  typedef struct 
+  struct actionItem_t
   {
-    actionId_t opId;          ///< id for the action specified by this item
-    float parm[MAX_MOTOR];    ///< function parameter
-  } actionItem_t;
+    uint8_t opId;             ///< actionId_t for the action specified by this item
+    int16_t parm[2];          ///< scaled function parameters
+
+    /**
+     * Item constructor.
+     *
+     * Convert the parameters to the stored integer values for the action.
+     *
+     * \param op the action id.
+     * \param p0 parameter 0.
+     * \param p1 parameter 1.
+     */
+    constexpr actionItem_t(actionId_t op = END, float p0 = 0, float p1 = 0) :
+      opId(op), parm{ encode(op, 0, p0), encode(op, 1, p1) } {}
+
+    /**
+     * Set a parameter of an item in RAM.
+     *
+     * \param n the parameter number [0..1].
+     * \param v the new value of the parameter.
+     */
+    void setParm(uint8_t n, float v) { parm[n] = encode((actionId_t)opId, n, v); }
+
+    /**
+     * Get a parameter of an item in RAM.
+     *
+     * \param n the parameter number [0..1].
+     * \return the value of the parameter.
+     */
+    float getParm(uint8_t n) const 
+      { return(isSigned((actionId_t)opId) ? (float)parm[n] / scale((actionId_t)opId, n) : (float)(uint16_t)parm[n]); }
+
+    static constexpr bool isSigned(actionId_t op)   ///< true if the action parameters are signed
+      { return(op == DRIVE || op == MOVE || op == SPIN); }
+    static constexpr uint8_t scale(actionId_t op, uint8_t n)  ///< parameter scaling for the action
+      { return((op == MOVE || (op == DRIVE && n == 1)) ? SEQ_ANGLE_SCALE : 1); }
+    static constexpr int16_t toSigned(float v)      ///< round and limit to int16_t
+      { return(v >= INT16_MAX ? INT16_MAX : (v <= INT16_MIN ? INT16_MIN : (int16_t)(v < 0 ? v - 0.5f : v + 0.5f))); }
+    static constexpr int16_t toUnsigned(float v)    ///< round and limit to uint16_t, stored as int16_t
+      { return((int16_t)(v >= UINT16_MAX ? UINT16_MAX : (v <= 0 ? 0 : (uint16_t)(v + 0.5f)))); }
+    static constexpr int16_t encode(actionId_t op, uint8_t n, float v)  ///< convert a parameter for storage
+      { return(isSigned(op) ? toSigned(v * scale(op, n)) : toUnsigned(v)); }
+  };
+
+  /**
+   * Timing statistics
+   *
+   * Loop timing measurements returned by getTimingStats(). The averages 
+   * follow the recent calls (each new measurement has a 1/16 weighting) 
+   * and the rest are counted since the last resetTimingStats().
+   */
+  typedef struct
+  {
+    uint32_t runCount;    ///< number of run() calls
+    uint32_t runMax;      ///< longest run() call in us
+    uint32_t runMean;     ///< average run() call in us
+    uint32_t loopMax;     ///< longest time between run() calls (time spent by the application) in us
+    uint32_t loopMean;    ///< average time between run() calls in us
+    uint32_t pidCount;    ///< number of PID steps (all motors)
+    uint16_t pidLateMax;  ///< latest a PID step ran after it was due in ms
+    float pidLateMean;    ///< average time a PID step ran after it was due in ms
+    uint16_t pidMissed;   ///< number of PID steps that were at least one whole PID period late
+    uint16_t isrRate;     ///< encoder interrupts per second (all motors) since the last getTimingStats() or reset
+  } timingStats_t;
+
+  /**
+   * Enumerated type for motion events
+   *
+   * Specifies what happened in an event_t (see \ref pageEvents).
+   */
+  enum eventId_t
+  {
+    EV_MOVE_DONE,     ///< a move() or spin() finished with all the wheels at the target
+    EV_MOVE_FAILED,   ///< a move() or spin() finished after a wheel timed out
+    EV_MOVE_TIMEOUT,  ///< a wheel stopped turning during a move() and was turned off; data motor number
+    EV_STALL,         ///< a wheel has stopped turning while it is driven; data motor number
+    EV_SEQ_STEP,      ///< a sequence started an action item; data item index
+    EV_SEQ_DONE,      ///< a sequence ended; data sequence priority
+    EV_SEQ_FAIL,      ///< a sequence item failed; data seqFail_t reason
+  };
+
+  /**
+   * Motion event
+   *
+   * An event reported by getEvent() or the event callback.
+   */
+  struct event_t
+  {
+    uint8_t id;       ///< eventId_t of the event
+    uint8_t data;     ///< event data, depending on the id
+    uint32_t time;    ///< millis() when the event happened
+  };
+
+  /**
+   * Event callback function
+   *
+   * A function registered with setEventCallback() that is called for 
+   * every event.
+   */
+  typedef void (*eventCallback_t)(const event_t& ev);
+
+  static const uint8_t EVENT_QUEUE_SIZE = SC_EVENT_QUEUE_SIZE;  ///< number of events kept for getEvent()
 
   /** @} */
 
@@ -205,12 +422,40 @@ public:
    * The main function for the core object is to reset the internal
    * shared variables and timers to default values.
    *
+   * Encoders may be single channel (SC_MotorEncoder) or quadrature 
+   * (SC_MotorEncoderQuad), and the two types may be mixed.
+   *
    * \param ml The object for controlling the left side motor.
    * \param el The object to use as the left side encoder input.
    * \param mr The object for controlling the right side motor.
    * \param er The object to use as the right side encoder input.
    */
+#if SC_MOTOR_COUNT == 2
   MD_SmartCar(SC_DCMotor* ml, SC_MotorEncoder* el, SC_DCMotor* mr, SC_MotorEncoder* er);
+#else
+  /**
+   * Class Constructor
+   *
+   * Instantiate a new instance of the class for a 4 motor vehicle
+   * (SC_MOTOR_COUNT set to 4).
+   *
+   * The motors are numbered 0 left front, 1 right front, 2 left rear 
+   * and 3 right rear for the methods that take a motor number.
+   *
+   * \param mlf  The object for controlling the left front motor.
+   * \param elf  The object to use as the left front encoder input.
+   * \param mrf  The object for controlling the right front motor.
+   * \param erf  The object to use as the right front encoder input.
+   * \param mlr  The object for controlling the left rear motor.
+   * \param elr  The object to use as the left rear encoder input.
+   * \param mrr  The object for controlling the right rear motor.
+   * \param err  The object to use as the right rear encoder input.
+   * \param type The drivetrain type, SKID_STEER or MECANUM.
+   */
+  MD_SmartCar(SC_DCMotor* mlf, SC_MotorEncoder* elf, SC_DCMotor* mrf, SC_MotorEncoder* erf,
+              SC_DCMotor* mlr, SC_MotorEncoder* elr, SC_DCMotor* mrr, SC_MotorEncoder* err,
+              drivetrain_t type = SKID_STEER);
+#endif
 
   /**
    * Class Destructor.
@@ -239,9 +484,10 @@ public:
     * \param ppsMax Maximum number of encoder pulses per second at top speed (100% velocity).
     * \param dWheel Wheel diameter in mm.
     * \param lBase  Base length (distance between wheel centers) in mm
-    * \return false if either encoder did not reset, true otherwise.
+    * \param lAxle  Distance between the front and rear axles in mm (MECANUM only).
+    * \return false if any encoder did not reset, true otherwise.
     */
-  bool begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase);
+  bool begin(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase, uint16_t lAxle = 0);
 
   /**
    * Set the vehicle constants
@@ -259,17 +505,67 @@ public:
    * \param ppsMax Maximum number of encoder pulses per second at top speed (100% velocity).
    * \param dWheel Wheel diameter in mm.
    * \param lBase  Base length (distance between wheel centers) in mm
+   * \param lAxle  Distance between the front and rear axles in mm (MECANUM only).
    */
-  void setVehicleParameters(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase);
+  void setVehicleParameters(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase, uint16_t lAxle = 0);
+
+  /**
+   * Get the drivetrain type.
+   *
+   * \sa \ref pageDrivetrain
+   *
+   * \return the drivetrain_t set when the object was created.
+   */
+  inline drivetrain_t getDrivetrain(void) { return(_drivetrain); }
 
   /**
    * Run the Robot Management Services.
    *
    * This is called every iteration through loop() to run all the required
    * Smart Car Management functions.
+   * 
+   * \sa tick()
    */
   void run(void);
 
+  /**
+   * Run the speed control from a timer interrupt.
+   *
+   * By default the drive() speed control runs from run() when the PID 
+   * period has expired, so its timing depends on how often loop() calls 
+   * run(). Once enabled by setTimerTick(), the speed control instead 
+   * runs every time tick() is called and run() only manages the motor 
+   * state changes and move() operations.
+   *
+   * tick() should be called from a timer interrupt (eg, set up with the 
+   * TimerOne library) at the configured PID period. Debug output should 
+   * be turned off as it is not suitable for use in an interrupt handler.
+   *
+   * \sa setTimerTick(), setPIDPeriod(), run()
+   */
+  void tick(void);
+
+  /**
+   * Set the speed control timing source.
+   *
+   * Select whether the drive() speed control is run from run() (the
+   * default) or from tick().
+   *
+   * \sa tick(), getTimerTick()
+   *
+   * \param b true to run the speed control from tick(), false to run it from run().
+   */
+  void setTimerTick(bool b) { _timerTick = b; }
+
+  /**
+   * Get the speed control timing source.
+   *
+   * \sa tick(), setTimerTick()
+   *
+   * \return true if the speed control is run from tick(), false if run from run().
+   */
+  bool getTimerTick(void) { return(_timerTick); }
+
   /**
    * Check if motors are running
    *
@@ -290,6 +586,20 @@ public:
    * \return true if any of the motors are not idle
    */
   bool isRunning(uint8_t mtr) { return(mtr < MAX_MOTOR ? _mData[mtr].state != S_IDLE : false); }
+
+  /**
+   * Check if the last move has completed
+   *
+   * Check if the last move() or spin() finished with all the wheels at their 
+   * target position. This is an event - it is reported once and cleared when 
+   * read. A move that is stopped, replaced by another motion or abandoned 
+   * because a wheel stopped turning is not reported as complete.
+   *
+   * \sa move(), spin(), setMoveTolerance()
+   *
+   * \return true if a move has completed since the last call.
+   */
+  bool isMoveComplete(void) { bool b = _moveComplete; _moveComplete = false; return(b); }
   /** @} */
 
   //--------------------------------------------------------------
@@ -342,12 +652,32 @@ public:
    * Angular velocity direction is specified in radians per second [-pi/2..pi/2]. Positive
    * angle is clockwise rotation.
    *
-   * \sa getLinearVelocity(), getAngularVelocity(), setPIDTuning()
+   * If a motion profile is set the wheel speeds are ramped to the new values 
+   * within the profile acceleration and jerk limits.
+   *
+   * \sa getLinearVelocity(), getAngularVelocity(), setPIDTuning(), setMotionProfile()
    *
    * \param vLinear   the linear velocity as a percentage of full scale [-100..100].
    * \param vAngularR the angular velocity in radians per second [-pi/2..pi/2].
    */
-  void drive(int8_t vLinear, float vAngularR);
+  void drive(int8_t vLinear, float vAngularR) { drive(vLinear, 0, vAngularR); }
+
+  /**
+   * Drive the vehicle along specified path with sideways motion (radians).
+   *
+   * As drive(int8_t, float), with a lateral velocity for a MECANUM drivetrain.
+   * The lateral velocity is specified as a percentage of the maximum vehicle 
+   * velocity [-100..100], positive to the right. It is ignored for the other 
+   * drivetrain types. The vehicle is stopped when both the linear and lateral 
+   * velocities are 0.
+   *
+   * \sa getLateralVelocity(), \ref pageDrivetrain
+   *
+   * \param vLinear   the linear velocity as a percentage of full scale [-100..100].
+   * \param vLateral  the lateral velocity as a percentage of full scale [-100..100].
+   * \param vAngularR the angular velocity in radians per second [-pi/2..pi/2].
+   */
+  void drive(int8_t vLinear, int8_t vLateral, float vAngularR);
 
   /**
    * Stop the smart car.
@@ -386,6 +716,19 @@ public:
    */
   inline int8_t getLinearVelocity(void) { return(_vLinear); }
 
+  /**
+   * Get the current lateral velocity.
+   *
+   * Lateral velocity is expressed as a percentage of the maximum velocity 
+   * [-100..100], positive to the right. It is always 0 unless the drivetrain 
+   * is MECANUM.
+   *
+   * \sa drive()
+   *
+   * \return the current lateral speed setting.
+   */
+  inline int8_t getLateralVelocity(void) { return(_vLateral); }
+
   /**
    * Set the angular velocity (radians).
    *
@@ -399,7 +742,7 @@ public:
    *
    * \param angR the new turning rate in radians.
    */
-  inline void setAngularVelocity(float angR) { drive(_vLinear, angR); }
+  inline void setAngularVelocity(float angR) { drive(_vLinear, _vLateral, angR); }
 
   /**
    * Set the angular velocity (degrees).
@@ -414,7 +757,7 @@ public:
    *
    * \param angD the new turning rate in degrees.
    */
-  inline void setAngularVelocity(int8_t angD) { drive(_vLinear, deg2rad(angD)); }
+  inline void setAngularVelocity(int8_t angD) { drive(_vLinear, _vLateral, deg2rad(angD)); }
 
   /**
    * Get the current angular velocity.
@@ -449,7 +792,15 @@ public:
    * by the turned by the wheel in radians. Negative angle is a reverse wheel
    * rotation.
    *
-   * \sa drive(), spin(), setMoveSP(), len2rad()
+   * With closed-loop position control each wheel is run under PID speed 
+   * control at the move velocity, and a position loop slows the wheel into 
+   * the target, reversing if it overshoots, until it is within the move 
+   * tolerance. If only a motion profile is set the wheels accelerate to the 
+   * move velocity and decelerate to stop at the target. Otherwise the motors 
+   * are run at the move PWM setting and stopped when the target is reached.
+   *
+   * \sa drive(), spin(), setMoveSP(), setMoveVelocity(), setMotionProfile(), 
+   * setPositionGain(), isMoveComplete(), len2rad()
    *
    * \param angL left wheel angle subtended by the motion in radians.
    * \param angR right wheel angle subtended by the motion in radians.
@@ -508,7 +859,10 @@ public:
   * rotation about the central axis passing through the vehicle base length.
   * Positive angle is a turn to the right, negative to the left.
   *
-  * \sa drive(), move(), setMoveSP()
+  * The spin adjustment is only applied when move() is run open loop (no 
+  * position control or motion profile), as the other modes stop at the target.
+  *
+  * \sa drive(), move(), setMoveSP(), setSpinSP(), setMotionProfile(), setPositionGain()
   *
   * \param fraction Percentage fraction of full revolution [-100..100]. Positive spins right; negative pins left.
   */
@@ -518,7 +872,8 @@ public:
    * Start an action sequence stored in PROGMEM.
    * 
    * This method passed the reference to an action sequence array stored in PROGMEM
-   * to the library for background execution.
+   * to the library for background execution. The sequence replaces the running 
+   * sequence and any waiting in the queue (see queueSequence()).
    * 
    * Details on actions sequences can be found at \ref pageActionSequence
    * 
@@ -532,7 +887,8 @@ public:
    * Start an action sequence stored in RAM.
    * 
    * This method passed the reference to an action sequence array stored in RAM
-   * to the library for background execution. The array must remain in scope
+   * to the library for background execution, replacing the running sequence 
+   * and any waiting in the queue. The array must remain in scope
    * (ie, global or static declaration) for the duration of the sequence 
    * running.
    *
@@ -544,24 +900,313 @@ public:
    */
   void startSequence(actionItem_t* actionList);
 
+  /**
+   * Queue a prioritized action sequence stored in PROGMEM.
+   *
+   * Run the sequence if it has a higher priority than the running sequence,
+   * preempting it, otherwise leave it in the queue to run later or drop it, 
+   * depending on the policy. A preempted sequence is also kept in the queue 
+   * or dropped depending on the policy it was queued with. When the running 
+   * sequence ends the highest priority sequence waiting in the queue is run. 
+   * Queuing a sequence that is already running or waiting does nothing, so
+   * it can be called every time a condition is detected.
+   *
+   * Details on actions sequences can be found at \ref pageActionSequence
+   *
+   * \sa startSequence(), getSequencePriority(), isSequenceComplete()
+   *
+   * \param actionList pointer to the array of actionItem_t ending with and END record.
+   * \param priority   the sequence priority, higher values preempt lower values.
+   * \param policy     one of the seqPolicy_t values.
+   * \return true if the sequence is running or waiting in the queue, false if it was dropped.
+   */
+  bool queueSequence(const actionItem_t* actionList, uint8_t priority, seqPolicy_t policy = SEQ_DISCARD);
+
+  /**
+   * Queue a prioritized action sequence stored in RAM.
+   *
+   * Same as queueSequence() for a PROGMEM sequence. The array must remain 
+   * in scope (ie, global or static declaration) while the sequence is 
+   * running or waiting in the queue.
+   *
+   * \sa startSequence(), getSequencePriority(), isSequenceComplete()
+   *
+   * \param actionList pointer to the array of actionItem_t ending with and END record.
+   * \param priority   the sequence priority, higher values preempt lower values.
+   * \param policy     one of the seqPolicy_t values.
+   * \return true if the sequence is running or waiting in the queue, false if it was dropped.
+   */
+  bool queueSequence(actionItem_t* actionList, uint8_t priority, seqPolicy_t policy = SEQ_DISCARD);
+
+  /**
+   * Get the priority of the running sequence.
+   *
+   * Sequences started with startSequence() have priority 0.
+   *
+   * \sa queueSequence()
+   *
+   * \return the priority of the running sequence, 0 if no sequence is running.
+   */
+  uint8_t getSequencePriority(void) { return(_inSequence ? _seq.priority : 0); }
+
+  /**
+   * Get the last sequence failure.
+   *
+   * Items that take time can fail, and what happens next is set by a 
+   * LIMIT item before them. The reason for the last failure is kept until 
+   * another sequence is started.
+   *
+   * Details on actions sequences can be found at \ref pageActionSequence
+   *
+   * \sa setEventCallback()
+   *
+   * \return the seqFail_t reason for the last failure, SEQ_FAIL_NONE if none.
+   */
+  seqFail_t getSequenceFailure(void) { return((seqFail_t)_seqFailure); }
+
   /**
    * Check if the current action sequence has completed.
    * 
    * Once an action sequence is started it will automatically execute to 
    * completion unless interrupted. This method checks to see if the
-   * action sequence has completed.
+   * action sequence, and any sequences waiting in the queue, have completed.
    * 
-   * \sa startSequence()
+   * \sa startSequence(), queueSequence()
    * 
    * \return true if the sequence has finished executing
    */
   bool isSequenceComplete(void) { return(!_inSequence); }
 
+  /**
+   * Register a sequence condition.
+   *
+   * Register the function that tests the condition with this id for the 
+   * JUMP_IF, JUMP_IFNOT and WAIT_UNTIL action items. A condition with no 
+   * function registered is always false.
+   *
+   * Details on actions sequences can be found at \ref pageActionSequence
+   *
+   * \sa startSequence()
+   *
+   * \param id the condition id [0..SEQ_CONDITIONS-1].
+   * \param fn the function to test the condition, nullptr to remove it.
+   * \return true if the condition was registered, false if the id is not valid.
+   */
+  bool setSequenceCondition(uint8_t id, seqCondition_t fn);
+
+  /** @} */
+  //--------------------------------------------------------------
+  /** \name Methods for Vehicle Position (Odometry).
+   * @{
+   */
+  /**
+   * Get the vehicle pose.
+   *
+   * The library keeps track of the vehicle position and heading by dead 
+   * reckoning from the wheel encoders every time run() is called. The pose 
+   * is relative to the position and heading at the last resetPose() or 
+   * begin(). The x axis is the initial heading and y is to the right of it.
+   * The heading is positive clockwise, the same as for drive().
+   * 
+   * Odometry accumulates errors from wheel slip and measurement, so the
+   * pose will drift over time and should be corrected from other sensors
+   * where possible.
+   *
+   * \sa resetPose(), \ref pageOdometry
+   *
+   * \param x     the x position in mm.
+   * \param y     the y position in mm.
+   * \param theta the heading in radians [-PI..PI].
+   */
+  void getPose(float& x, float& y, float& theta);
+
+  /**
+   * Reset the vehicle pose.
+   *
+   * Set the pose to the origin, facing along the x axis.
+   *
+   * \sa getPose()
+   */
+  void resetPose(void);
+
+  /** @} */
+  //--------------------------------------------------------------
+  /** \name Methods for Motion Events.
+   * @{
+   */
+  /**
+   * Register the event callback.
+   *
+   * The callback is called for each event at the end of run(), after 
+   * the library has finished its work, so it can start new motions or 
+   * sequences. While a callback is registered the events are not kept
+   * for getEvent().
+   *
+   * Details on events can be found at \ref pageEvents
+   *
+   * \sa getEvent(), eventId_t
+   *
+   * \param fn the callback function, nullptr to remove it.
+   */
+  void setEventCallback(eventCallback_t fn) { _evCallback = fn; }
+
+  /**
+   * Get the next event.
+   *
+   * Take the oldest event from the event queue. Up to EVENT_QUEUE_SIZE 
+   * events are kept, and the oldest are dropped if they are not read in
+   * time.
+   *
+   * Details on events can be found at \ref pageEvents
+   *
+   * \sa setEventCallback(), eventId_t
+   *
+   * \param ev the event structure to fill in.
+   * \return true if there was an event, false if the queue is empty.
+   */
+  bool getEvent(event_t& ev);
+
+  /** @} */
+  //--------------------------------------------------------------
+  /** \name Methods for Loop Timing Instrumentation.
+   * @{
+   */
+  /**
+   * Turn the timing statistics on or off.
+   *
+   * The library can measure how long each run() call takes, how long the 
+   * application takes between run() calls, how late the PID steps run 
+   * compared to the PID period and the encoder interrupt rate. This shows 
+   * when the rest of the application (eg, blocking sensor reads) is starving 
+   * the speed control. Collecting the statistics adds a few micros() calls
+   * to every run(), so it is off by default.
+   *
+   * Turning the statistics on also resets them.
+   *
+   * \sa getTimingStats(), resetTimingStats()
+   *
+   * \param b true to collect timing statistics, false to stop.
+   */
+  void setTimingStats(bool b);
+
+  /**
+   * Check if the timing statistics are on.
+   *
+   * \sa setTimingStats()
+   *
+   * \return true if the timing statistics are being collected.
+   */
+  inline bool isTimingStats(void) { return(_statsOn); }
+
+  /**
+   * Get the timing statistics.
+   *
+   * Copy the current timing statistics. The encoder interrupt rate is 
+   * measured over the time since the last call (or resetTimingStats()), 
+   * so calling this regularly shows the current interrupt load.
+   *
+   * \sa setTimingStats(), resetTimingStats(), timingStats_t
+   *
+   * \param stats the structure to fill in.
+   */
+  void getTimingStats(timingStats_t& stats);
+
+  /**
+   * Reset the timing statistics.
+   *
+   * Clear the statistics and start measuring again from now.
+   *
+   * \sa setTimingStats(), getTimingStats()
+   */
+  void resetTimingStats(void);
+
   /** @} */
   //--------------------------------------------------------------
   /** \name Methods for EEPROM and Configuration Management.
    * @{
    */
+  /**
+   * Start automatic calibration.
+   *
+   * Measure the motors and work out the configuration settings. Each motor 
+   * is run forward through a series of PWM steps to find the PWM needed to 
+   * start it, the top speed, the speed against PWM, the time constant 
+   * and the PWM below which it stalls. From these the library sets the 
+   * PWM limits, kicker and move() PWM, PID parameters and maximum speed, 
+   * and saves the configuration to EEPROM. The feed-forward model 
+   * (setFeedForward()) is also set if requested, otherwise it is left 
+   * unchanged.
+   *
+   * The calibration runs in the background from run() and takes about 
+   * 10-20 seconds. The wheels should be free to turn (eg, the vehicle on a 
+   * stand), otherwise the vehicle will travel forward several meters. 
+   * isRunning() is true while it is in progress and any other motion 
+   * command (or stop()) abandons it.
+   *
+   * The maximum speed measured replaces the value passed to begin() until 
+   * the next begin(), so it should be copied into the application using 
+   * getMaxPPS().
+   *
+   * \sa isCalibrateComplete(), getMaxPPS(), \ref pageSetupAuto
+   *
+   * \param feedForward true to also set the feed-forward from the measurements.
+   */
+  void autoCalibrate(bool feedForward = false);
+
+  /**
+   * Check if automatic calibration has completed
+   *
+   * Check if autoCalibrate() has finished and saved the new configuration.
+   * This is an event - it is reported once and cleared when read. A 
+   * calibration that is abandoned or fails (eg, a motor does not start) is 
+   * not reported as complete and the configuration is unchanged.
+   *
+   * \sa autoCalibrate()
+   *
+   * \return true if a calibration has completed since the last call.
+   */
+  bool isCalibrateComplete(void) { bool b = _calComplete; _calComplete = false; return(b); }
+
+  /**
+   * Automatically tune the speed PID for a motor.
+   *
+   * Run the motor forward under PID control at the specified speed, then 
+   * use the SC_PID relay autotune to measure the ultimate gain and period 
+   * at that speed. The PID parameters for the motor are worked out from 
+   * these using the specified rule and replace the current parameters. 
+   * They are not saved to EEPROM - use saveConfig() once the results are 
+   * found to be good.
+   *
+   * The tuning runs in the background from run(), even if the speed control 
+   * is normally run from tick(), and takes about 5-10 seconds. The wheel 
+   * should be free to turn. Both motors can be tuned at the same time. 
+   * isRunning() is true while it is in progress and any other motion command 
+   * (or stop()) abandons it.
+   *
+   * \sa isTuneComplete(), setPIDTuning(), SC_PID::startTune(), \ref pagePID
+   *
+   * \param mtr  the motor number [0..MAX_MOTOR-1].
+   * \param vel  the speed to tune at as a percentage of the maximum [1..100].
+   * \param rule the rule used to work out the PID parameters.
+   * \return false if the parameters are not valid.
+   */
+  bool autoTune(uint8_t mtr, uint8_t vel, SC_PID::tuneRule_t rule = SC_PID::NO_OVERSHOOT);
+
+  /**
+   * Check if automatic tuning has completed
+   *
+   * Check if autoTune() has finished for the specified motor and the new 
+   * PID parameters are in use. This is an event - it is reported once and 
+   * cleared when read. A tuning that is abandoned or fails (eg, the speed 
+   * does not oscillate) is not reported and the parameters are unchanged.
+   *
+   * \sa autoTune(), getPIDTuning()
+   *
+   * \param mtr the motor number [0..MAX_MOTOR-1].
+   * \return true if tuning has completed for the motor since the last call.
+   */
+  bool isTuneComplete(uint8_t mtr) { bool b = (mtr < MAX_MOTOR) && (_tuneComplete & (1 << mtr)); if (b) _tuneComplete &= ~(1 << mtr); return(b); }
+
    /**
     * Load settings from EEPROM.
     *
@@ -608,6 +1253,137 @@ public:
    */
   uint8_t getMoveSP(void) { return(_config.movePWM); }
 
+  /**
+   * Set the profiled move velocity.
+   *
+   * Set the cruising velocity used by move() and spin() when a motion
+   * profile or position control is set.
+   *
+   * \sa move(), getMoveVelocity(), setMotionProfile(), saveConfig()
+   *
+   * \param vel the velocity as a percentage of full scale [1..100].
+   * \return true if the value was set, false if it fails sanity checks.
+   */
+  bool setMoveVelocity(uint8_t vel);
+
+  /**
+   * Get the profiled move velocity.
+   *
+   * \sa move(), setMoveVelocity(), saveConfig()
+   *
+   * \return the velocity as a percentage of full scale.
+   */
+  uint8_t getMoveVelocity(void) { return(_config.moveVelocity); }
+
+  /**
+   * Set the motion profile limits.
+   *
+   * Set the acceleration and jerk limits of the motion profile used by 
+   * drive(), move() and spin(). The limits are a percentage of the full 
+   * scale velocity per second (acceleration) and per second per second 
+   * (jerk). For example, an acceleration of 200 will take 0.5 seconds to 
+   * reach full speed.
+   *
+   * An acceleration of 0 turns off the motion profile, which is the default
+   * (MC_ACCEL_MAX). A jerk of 0 gives a trapezoidal profile, otherwise the 
+   * profile is an S-curve.
+   *
+   * \sa getMotionProfile(), \ref pageMotionProfile, saveConfig()
+   *
+   * \param accel the acceleration limit in %/s.
+   * \param jerk  the jerk limit in %/s/s.
+   */
+  void setMotionProfile(uint16_t accel, uint16_t jerk);
+
+  /**
+   * Get the motion profile limits.
+   *
+   * \sa setMotionProfile(), saveConfig()
+   *
+   * \param accel the acceleration limit in %/s.
+   * \param jerk  the jerk limit in %/s/s.
+   */
+  void getMotionProfile(uint16_t& accel, uint16_t& jerk) { accel = _config.accelMax; jerk = _config.jerkMax; }
+
+  /**
+   * Set the position control gain.
+   *
+   * Set the proportional gain of the move() position loop. The position 
+   * loop sets the wheel speed to the gain times the distance remaining, so 
+   * the units are pulses per second for each pulse of position error. 
+   * Higher gains stop more sharply but may overshoot.
+   *
+   * A gain of 0 turns off closed-loop position control, which is the 
+   * default (MC_POS_KP).
+   *
+   * \sa move(), getPositionGain(), setMoveTolerance(), saveConfig()
+   *
+   * \param Kp the position gain (0 to turn off).
+   * \return true if the value was set, false if it fails sanity checks.
+   */
+  bool setPositionGain(float Kp);
+
+  /**
+   * Get the position control gain.
+   *
+   * \sa setPositionGain(), saveConfig()
+   *
+   * \return the position gain, 0 if position control is off.
+   */
+  float getPositionGain(void) { return(_config.posKp); }
+
+  /**
+   * Set the move position tolerance.
+   *
+   * With closed-loop position control a wheel has finished its move when it 
+   * has stopped within this number of encoder pulses of the target.
+   *
+   * \sa move(), getMoveTolerance(), setPositionGain(), saveConfig()
+   *
+   * \param pulses the tolerance in encoder pulses.
+   */
+  void setMoveTolerance(uint8_t pulses) { _config.moveTolerance = pulses; }
+
+  /**
+   * Get the move position tolerance.
+   *
+   * \sa setMoveTolerance(), saveConfig()
+   *
+   * \return the tolerance in encoder pulses.
+   */
+  uint8_t getMoveTolerance(void) { return(_config.moveTolerance); }
+
+  /**
+   * Set the wheel synchronization gain.
+   *
+   * Set the gain of the cross-coupling between the wheel speed controllers 
+   * for drive() and move(). Each wheel keeps track of how far it is ahead 
+   * or behind the distance expected from its set point. The difference 
+   * between the wheels is fed back into both speed set points, slowing 
+   * the wheel that is ahead and speeding up the one that is behind, so 
+   * that the vehicle keeps to the commanded path (eg, a straight line) 
+   * even when the motors are not matched.
+   *
+   * The units are pulses per second for each pulse of difference between 
+   * the wheels. A gain of 0 turns off the synchronization, which is the 
+   * default (MC_SYNC_KP).
+   *
+   * \sa drive(), move(), getSyncGain(), saveConfig()
+   *
+   * \param Ks the synchronization gain (0 to turn off).
+   * \return true if the value was set, false if it fails sanity checks.
+   */
+  bool setSyncGain(float Ks);
+
+  /**
+   * Get the wheel synchronization gain.
+   *
+   * \sa setSyncGain(), saveConfig()
+   *
+   * \return the synchronization gain, 0 if synchronization is off.
+   */
+  float getSyncGain(void) { return(_config.syncKp); }
+
   /**
    * Set the drive kicker speed.
    *
@@ -750,6 +1526,118 @@ public:
    */
   void getPIDTuning(uint8_t mtr, float& Kp, float& Ki, float& Kd);
 
+  /**
+   * Set feed-forward parameters.
+   *
+   * Change the feed-forward motor model for the specified motor. The speed
+   * controller output is the model output (Ks + Kv * pps) plus the PID 
+   * correction. Ks is the PWM needed to overcome friction and Kv is the 
+   * additional PWM for each pulse per second of speed.
+   *
+   * When feed-forward is set for a motor, it starts under speed control 
+   * without the kicker.
+   *
+   * Setting both parameters to 0 turns off feed-forward for the motor.
+   *
+   * \sa getFeedForward(), setPIDTuning(), \ref pagePID, saveConfig()
+   *
+   * \param mtr the motor number [0..MAX_MOTOR-1].
+   * \param Ks the static friction offset in PWM units.
+   * \param Kv the speed slope in PWM units per pps.
+   */
+  void setFeedForward(uint8_t mtr, float Ks, float Kv);
+
+  /**
+   * Get feed-forward parameters.
+   *
+   * Return the current feed-forward motor model for the specified motor.
+   *
+   * \sa setFeedForward(), saveConfig()
+   *
+   * \param mtr the motor number [0..MAX_MOTOR-1].
+   * \param Ks the static friction offset in PWM units.
+   * \param Kv the speed slope in PWM units per pps.
+   */
+  void getFeedForward(uint8_t mtr, float& Ks, float& Kv);
+
+  /**
+   * Set the PID control period.
+   *
+   * Set the time between drive() speed control updates. Shorter periods 
+   * correct disturbances faster but need more processing time. The PID 
+   * tuning parameters are rescaled internally so that the same parameters 
+   * give a similar response at any period.
+   *
+   * If the speed control is run from tick(), the timer must be changed 
+   * to match the new period.
+   *
+   * \sa getPIDPeriod(), setTimerTick(), saveConfig()
+   *
+   * \param period the PID period in ms [PID_PERIOD_MIN..PID_PERIOD_MAX].
+   * \return true if the value was set, false if it fails sanity checks.
+   */
+  bool setPIDPeriod(uint16_t period);
+
+  /**
+   * Get the PID control period.
+   *
+   * \sa setPIDPeriod(), saveConfig()
+   *
+   * \return the PID period in ms.
+   */
+  uint16_t getPIDPeriod(void) { return(_config.pidPeriod); }
+
+  /**
+   * Set the PID output conditioning.
+   *
+   * Set the derivative filter time constant and the output slew limit for 
+   * the speed PID of all the motors. The filter smooths the encoder noise 
+   * that gets into the motor PWM through the derivative (Kd) part of the 
+   * PID, which allows a higher Kd or a shorter PID period without the PWM 
+   * chattering. The slew limit is the largest change in PWM at each PID 
+   * step.
+   *
+   * \sa getPIDFilter(), setPIDTuning(), \ref pagePID, saveConfig()
+   *
+   * \param filter the derivative filter time constant in ms, 0 for no filter.
+   * \param slew   the largest PWM change per PID period, 0 for no limit.
+   */
+  void setPIDFilter(uint16_t filter, uint8_t slew);
+
+  /**
+   * Get the PID output conditioning.
+   *
+   * \sa setPIDFilter(), saveConfig()
+   *
+   * \param filter the derivative filter time constant in ms, 0 for no filter.
+   * \param slew   the largest PWM change per PID period, 0 for no limit.
+   */
+  void getPIDFilter(uint16_t& filter, uint8_t& slew) { filter = _config.pidFilter; slew = _config.pidSlew; }
+
+  /**
+   * Set the encoder speed filter.
+   *
+   * The speed of each motor read from its encoder is smoothed by an 
+   * alpha-beta filter before it is used by the speed PID. This sets the
+   * alpha gain of the filter in %. Lower values smooth the encoder noise 
+   * more but respond more slowly. 100 turns the filtering off.
+   *
+   * \sa getSpeedFilter(), \ref pageVelocityEstimator, saveConfig()
+   *
+   * \param alpha the filter alpha gain in % [1..100].
+   * \return true if the value was set, false if it fails sanity checks.
+   */
+  bool setSpeedFilter(uint8_t alpha);
+
+  /**
+   * Get the encoder speed filter.
+   *
+   * \sa setSpeedFilter(), saveConfig()
+   *
+   * \return the filter alpha gain in %.
+   */
+  uint8_t getSpeedFilter(void) { return(_config.speedAlpha); }
+
   /**
    * Read pulses per encoder revolution
    *
@@ -762,6 +1650,18 @@ public:
    */
   inline uint16_t getPulsePerRev() { return(_ppr); }
 
+  /**
+   * Read maximum encoder pulses per second
+   *
+   * Returns the number of encoder pulses per second at top speed (100% 
+   * velocity), as set by begin() or measured by autoCalibrate().
+   *
+   * \sa setVehicleParameters(), autoCalibrate()
+   *
+   * \return The maximum pulses per second.
+   */
+  inline uint16_t getMaxPPS() { return(_ppsMax); }
+
   /** @} */
   //--------------------------------------------------------------
   /** \name Utility methods.
@@ -794,35 +1694,111 @@ private:
   // Motor array indices
   const uint8_t MLEFT = 0;      ///< Array index for the Left motor
   const uint8_t MRIGHT = 1;     ///< Array index for the right motor
+  const uint8_t MLEFT_REAR = 2; ///< Array index for the left rear motor (4 motors)
+  const uint8_t MRIGHT_REAR = 3;///< Array index for the right rear motor (4 motors)
+  static const uint8_t SIDE_MOTOR = MAX_MOTOR / 2;  ///< motors on each side of the vehicle
 
-  enum runState_t { S_IDLE, S_DRIVE_INIT, S_DRIVE_KICKER, S_DRIVE_PIDRST, S_DRIVE_RUN, S_MOVE_INIT, S_MOVE_RUN };
+  enum runState_t { S_IDLE, S_DRIVE_INIT, S_DRIVE_KICKER, S_DRIVE_PIDRST, S_DRIVE_RUN, S_MOVE_INIT, S_MOVE_RUN, S_MOVE_HOLD,
+                    S_CAL_START, S_CAL_HIGH, S_CAL_LOW, S_CAL_STALL, S_TUNE_INIT, S_TUNE_RUN };
 
   float _vMaxLinear;      ///< Maximum linear speed in pulses/second 
   int16_t _vLinear;       ///< Master velocity setting as percentage [0..100] = [0.._vMaxLinear]
+  int16_t _vLateral;      ///< Lateral velocity setting as percentage [-100..100], MECANUM only
   float _vAngular;        ///< angular velocity in in radians per second [-PI..PI]
+  drivetrain_t _drivetrain; ///< how the motors move the vehicle
 
   // Vehicle constants
   uint16_t _ppr;          ///< Encoder pulses per wheel revolution
   uint16_t _diaWheel;     ///< Wheel diameter in mm
   uint16_t _lenBase;      ///< Base length in mm (distance between wheel centers)
+  uint16_t _lenAxle;      ///< Axle length in mm (distance between front and rear axles)
   uint16_t _ppsMax;       ///< Encoder maximum pulse per second (full speed reading)
 
   float _lenPerPulse;     ///< Length traveled per pulse of wheel revolution
   float _diaWheelP;       ///< Wheel diameter in pulses (calculated)
-  float _lenBaseP;        ///< Base Length in pulses (calculated)
+  float _lenBaseP;        ///< Base Length in pulses (calculated, effective turning base for MECANUM)
 
   // Data for tracking action sequences
   bool _inSequence;       ///< true if currently executing a sequence
   bool _inAction;         ///< waiting for current item to complete
-  bool _seqIsConstant;    ///< true if sequence is stored is declared in PROGMEM
-  union 
-  {                 ///< current list of actions being sequenced
-    const actionItem_t* cp; 
-    actionItem_t* p;
-  } _uAction;
-  uint8_t _curActionItem; ///< index for the current action item
-  actionItem_t _ai;       ///< current action item
-  uint32_t _timeStartSeq; ///< generic time variable for sequences
+  const actionItem_t* _ai;  ///< current action item, read in place
+  uint32_t _timeStartSeq; ///< time the current sequence item started
+  uint8_t _seqFailure;    ///< seqFail_t reason for the last sequence failure
+
+  static const uint8_t SEQ_CALL_DEPTH = 4;  ///< CALL nesting depth
+  static const uint8_t SEQ_LOOP_DEPTH = 4;  ///< REPEAT nesting depth
+  static const uint8_t SEQ_NO_ITEM = 0xff;  ///< no item index
+
+  seqCondition_t _seqCond[SEQ_CONDITIONS];  ///< registered sequence conditions
+
+  struct seqState_t     ///< everything needed to run or resume a sequence
+  {
+    const actionItem_t* list; ///< list of actions being sequenced
+    bool isConstant;      ///< true if the list is declared in PROGMEM
+    uint8_t priority;     ///< sequence priority, higher preempts lower
+    uint8_t policy;       ///< seqPolicy_t if the sequence is preempted
+    uint8_t item;         ///< index for the next action item
+    uint8_t call[SEQ_CALL_DEPTH]; ///< return item index for each CALL
+    uint8_t callDepth;    ///< number of CALLs in progress
+    struct
+    {
+      uint8_t start;      ///< index of the first item in the loop
+      uint8_t item;       ///< index of the REPEAT item
+      uint16_t count;     ///< times left to go back to the start of the loop
+    } loop[SEQ_LOOP_DEPTH];   ///< REPEAT loops in progress
+    uint8_t loopDepth;    ///< number of REPEAT loops in progress
+    uint16_t limit;       ///< LIMIT time for limitItem in ms, 0 for none
+    uint8_t limitItem;    ///< index of the item the LIMIT applies to, SEQ_NO_ITEM for none
+    uint8_t onFail;       ///< item index, SEQ_SKIP or SEQ_ABORT if limitItem fails
+  };
+
+  seqState_t _seq;        ///< the running sequence
+  seqState_t _seqQueue[SEQ_QUEUE_SIZE]; ///< sequences waiting to run, oldest first
+  uint8_t _seqQueued;     ///< number of sequences waiting in _seqQueue
+  bool _inSeqItem;        ///< true while a sequence item is being run
+
+  // Motion events
+  eventCallback_t _evCallback;          ///< registered event callback
+  event_t _evQueue[EVENT_QUEUE_SIZE];   ///< events waiting for getEvent()
+  uint8_t _evHead;        ///< index of the oldest event in _evQueue
+  uint8_t _evCount;       ///< number of events in _evQueue
+
+  bool _timerTick;        ///< true if the speed control is run from tick()
+
+  // Move completion tracking
+  bool _moveActive;       ///< a move() is being tracked for completion
+  bool _moveFailed;       ///< a wheel timed out during the current move()
+  bool _moveComplete;     ///< completion event for isMoveComplete()
+
+  // Calibration tracking
+  bool _calActive;        ///< an autoCalibrate() is in progress
+  bool _calFailed;        ///< a motor could not be calibrated
+  bool _calComplete;      ///< completion event for isCalibrateComplete()
+  bool _calFF;            ///< set the feed-forward from the calibration
+  uint8_t _tuneComplete;  ///< completion events for isTuneComplete(), one bit per motor
+
+  // Timing instrumentation
+  bool _statsOn;            ///< timing statistics are being collected
+  timingStats_t _stats;     ///< timing statistics, averages not filled in
+  uint32_t _statsRunAvg;    ///< average run() time in us (Q4 fixed point)
+  uint32_t _statsLoopAvg;   ///< average time between run() calls in us (Q4 fixed point)
+  uint32_t _statsLateSum;   ///< total PID lateness in ms
+  uint32_t _statsRunEnd;    ///< micros() at the end of the last run()
+  uint32_t _statsStart;     ///< millis() of the last getTimingStats() or reset
+  uint32_t _statsISR;       ///< encoder interrupts since _statsStart
+  uint16_t _statsISRRate;   ///< isrRate from the last getTimingStats()
+  uint16_t _statsISRLast[MAX_MOTOR]; ///< encoder interrupt counts at the last run()
+  uint32_t _statsPIDLast[MAX_MOTOR]; ///< millis() of the last PID step for each motor
+
+  // Odometry pose
+#if POSE_FIXED_POINT
+  int32_t _poseX, _poseY; ///< position in encoder pulses (Q8 fixed point)
+  uint32_t _poseTheta;    ///< heading as a binary angle (2^32 = full circle)
+  int32_t _kTheta;        ///< heading change per pulse of wheel difference (2^24 = full circle)
+#else
+  float _poseX, _poseY;   ///< position in mm
+  float _poseTheta;       ///< heading in radians
+#endif
 
   // Define the control objects
   SC_DCMotor* _M[MAX_MOTOR];      ///< Motor controllers
@@ -840,10 +1816,26 @@ private:
     uint8_t kickerPWM;    ///< kicker to overcome static friction from stop position
     float spinAdjust;     ///< spin inertia adjustment
 
+    // Motion profile
+    uint16_t accelMax;    ///< acceleration limit in %/s, 0 for no motion profile
+    uint16_t jerkMax;     ///< jerk limit in %/s/s, 0 for trapezoidal profile
+    uint8_t moveVelocity; ///< profiled move() velocity in %
+
+    // Position control
+    float posKp;          ///< move() position loop gain in pps/pulse, 0 for no position control
+    uint8_t moveTolerance;///< move() position tolerance in pulses
+    float syncKp;         ///< wheel synchronization gain in pps/pulse, 0 for no synchronization
+
     // PID values
+    uint16_t pidPeriod;   ///< PID control period in ms
+    uint16_t pidFilter;   ///< PID derivative filter time constant in ms, 0 for no filter
+    uint8_t pidSlew;      ///< PID output slew limit in PWM per PID period, 0 for no limit
+    uint8_t speedAlpha;   ///< encoder speed filter alpha gain in %, 100 for no filter
     float Kp[MAX_MOTOR];  ///< PID parameter per motor
     float Ki[MAX_MOTOR];  ///< PID parameter per motor
     float Kd[MAX_MOTOR];  ///< PID parameter per motor
+    float Ks[MAX_MOTOR];  ///< feed-forward static offset (PWM) per motor
+    float Kv[MAX_MOTOR];  ///< feed-forward slope (PWM per pps) per motor
   } _config;
 
   // Motor state data used to manage each motor
@@ -852,14 +1844,55 @@ private:
     SC_DCMotor::runCmd_t direction;   ///< turning direction
 
     // PID variables
-    int16_t sp;     ///< drive() PID set point value / move() PWM setting
-    int16_t cv;     ///< drive() PID current value / move() target number of encoder pulses
+    int16_t sp;     ///< PID set point value (fixed point pps, see SPEED_FX_BITS) / move() PWM setting
+    int16_t cv;     ///< PID current value (fixed point pps, see SPEED_FX_BITS)
     int16_t co;     ///< PID control output
     SC_PID* pid;    ///< PID object for control
 
+    // Motion profile
+    SC_MotionProfile prof;  ///< motion profile for the PID set point
+    float spTarget;         ///< drive() target speed (signed pps) / profiled move() speed (pps)
+    SC_VelocityEstimator vel; ///< encoder speed filter
+
     // Run state variables
     runState_t state;      ///< control state for this motor
     uint32_t   timeLast;  ///< time last event (eg, PID) was last run (ms)
+
+    // Encoder tracking
+    SC_MotorEncoder::snapshot_t enc;  ///< encoder snapshot at the last read
+    int32_t pos;          ///< move() pulses traveled (signed, positive forward)
+    int32_t target;       ///< move() target number of encoder pulses (signed)
+
+    // Position loop
+    int16_t posSp;  ///< position PID set point (always 0)
+    int16_t posCv;  ///< position PID current value (pulses past the target)
+    int16_t posCo;  ///< position PID control output (pps towards the target)
+    SC_PID* pidPos; ///< PID object for the position loop
+    bool posLoop;   ///< true when the position loop is controlling the speed
+
+    // Wheel synchronization
+    float posRef;   ///< travel expected from the set points (pulses, signed)
+    float lag;      ///< travel ahead (+) or behind (-) posRef in the direction of travel at the last PID step
+    float lagLast;  ///< lag at the PID step before the last
+    uint32_t timeMove;    ///< move() and drive() watchdog, time the last pulse was seen (ms)
+    uint32_t timeTune;    ///< autoTune() time the PID control started (ms)
+    uint32_t timeSettle;  ///< autoTune() time the speed last settled within the noise band (ms)
+    SC_PID::tuneRule_t tuneRule;  ///< autoTune() rule for the PID parameters
+    SC_MotorEncoder::snapshot_t odo;  ///< encoder snapshot at the last pose update
+
+    // autoCalibrate() measurements
+    struct
+    {
+      bool measure;     ///< speed has settled and is being measured
+      uint8_t pwmStart; ///< PWM that started the motor
+      uint8_t pwmStall; ///< lowest PWM that kept the motor turning
+      int16_t ppsStep;  ///< speed before the step up to full power (pps)
+      int16_t ppsHigh;  ///< steady speed at full power (pps)
+      int16_t ppsLow;   ///< steady speed at the low PWM (pps)
+      float tau;        ///< motor time constant (s)
+      int32_t count0;   ///< encoder count at the step up to full power
+      uint32_t time0;   ///< time of the step up to full power (us)
+    } cal;
   };
   
   motorData_t _mData[MAX_MOTOR];  ///< keeping track of each motor's parameters
@@ -867,9 +1900,38 @@ private:
   // Private Methods
   void printConfig(void);               ///< debug only
   void setPIDOutputLimits(void);        ///< set the PID limits for all motors
+  void setPIDParameters(uint8_t mtr);   ///< set the PID period and scaled tuning for a motor
+  void setProfileLimits(void);          ///< set the motion profile limits for all motors
+  bool isProfiled(void) { return(_config.accelMax != 0); }  ///< true if motion profiles are used
+  bool isPosControl(void) { return(_config.posKp != 0.0); } ///< true if move() uses position control
+  bool isFeedForward(uint8_t mtr) { return(_config.Ks[mtr] != 0.0 || _config.Kv[mtr] != 0.0); } ///< true if the motor has a feed-forward model
+  uint8_t startSP(uint8_t mtr) { return(isFeedForward(mtr) ? 0 : getKickerSP()); } ///< motor output to start speed control
+  bool isLeft(uint8_t mtr) { return((mtr & 1) == 0); }  ///< true if the motor is on the left side
+  int32_t moveRemaining(uint8_t mtr);   ///< move() pulses to go in the direction of the target
+  float syncCorrection(uint8_t mtr, uint32_t now); ///< wheel synchronization speed correction for a motor (pps)
+  void runPID(uint8_t motor, uint32_t now, bool& firstPass); ///< run one speed control step for a motor
+  int32_t cmdDirection(uint8_t mtr, int32_t v); ///< make encoder value v relative to the commanded direction
+  int32_t fwdDirection(uint8_t mtr, int32_t v); ///< make encoder value v positive in the forward direction
+  void updatePose(void);                ///< integrate the encoder motion into the pose
+  void statsRun(uint32_t tStart);       ///< timing statistics for the run() that started at micros() tStart
+  void statsPID(uint8_t motor, uint32_t now); ///< timing statistics for a PID step about to run
+  void runCalibrate(uint8_t motor, uint32_t now); ///< run the autoCalibrate() steps for a motor
+  void calibrateDone(void);             ///< work out and save the configuration from the calibration
+  void runTune(uint8_t motor, uint32_t now);  ///< run the autoTune() steps for a motor
+  uint8_t calLowSP(uint8_t mtr) { return(_mData[mtr].cal.pwmStart + ((getMaxMotorSP() - _mData[mtr].cal.pwmStart) / 3)); } ///< calibration low PWM setting
 
   void startSeqCommon(void);            ///< common part of sequence start
+  bool queueSeqCommon(const actionItem_t* actionList, bool isConstant, uint8_t priority, seqPolicy_t policy); ///< common part of queueSequence()
+  bool seqSave(const seqState_t& sq, bool first); ///< put a sequence in the queue
+  void seqResume(void);                 ///< run the highest priority sequence in the queue
+  void raiseEvent(uint8_t id, uint8_t data = 0);  ///< add an event to the queue
   void runSequence(void);               ///< keep running current sequence
-  bool runActionItem(actionItem_t& ai); ///< run the logic for this action item
+  bool runActionItem(void);             ///< run the logic for the current action item
+  uint8_t seqOpId(void) { return(_seq.isConstant ? pgm_read_byte(&_ai->opId) : _ai->opId); } ///< action id of the current item
+  int16_t seqParm(uint8_t n) { return(_seq.isConstant ? (int16_t)pgm_read_word(&_ai->parm[n]) : _ai->parm[n]); } ///< stored parameter of the current item
+  bool isSeqCondition(uint8_t id) { return(id < SEQ_CONDITIONS && _seqCond[id] != nullptr && _seqCond[id]()); } ///< test a sequence condition
+  void seqJump(uint8_t target);         ///< continue the sequence from the target item
+  void seqRepeat(uint16_t count, uint8_t target); ///< run the REPEAT action item
+  void seqFail(seqFail_t reason);       ///< handle a sequence item failure
 
 };
@@ -0,0 +1,342 @@
+#include <MD_SmartCar.h>
+
+/**
+ * \file
+ * \brief Code file for MD_SmartCar library class - automatic motor calibration and tuning.
+ */
+
+// autoCalibrate() timing and PWM settings
+const uint16_t CAL_STEP_TIME = 200;     ///< time at each PWM step of a ramp in ms
+const uint16_t CAL_SETTLE_TIME = 600;   ///< time for the speed to settle after a PWM step in ms
+const uint16_t CAL_MEASURE_TIME = 400;  ///< time to measure a steady speed in ms
+const uint8_t CAL_PWM_STEP = 2;         ///< PWM change for each step of a ramp
+const uint8_t CAL_PWM_MARGIN = 5;       ///< PWM added to the measured start threshold
+const uint8_t CAL_START_COUNT = 2;      ///< pulses in one ramp step to count as started
+
+// autoTune() settings
+const uint16_t TUNE_SETTLE_TIME = 1000; ///< time the speed must stay settled before tuning in ms
+const uint16_t TUNE_SETTLE_MAX = 10000; ///< time allowed for the speed to settle in ms
+const uint8_t TUNE_STEP_DIV = 8;        ///< relay step is the PWM range divided by this
+const uint8_t TUNE_CYCLES = 4;          ///< oscillation cycles measured
+
+void MD_SmartCar::autoCalibrate(bool feedForward)
+{
+  SCPRINT("\n** CALIBRATE ff:", feedForward);
+
+  stop();
+
+  noInterrupts();     // tick() may be using the motors
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    _mData[i].direction = SC_DCMotor::DIR_FWD;
+    _mData[i].co = 0;
+    _mData[i].cal.measure = false;
+    _mData[i].cal.tau = 0.0;
+    _E[i]->snapshot(_mData[i].enc);
+    _mData[i].timeLast = millis();
+    _mData[i].state = S_CAL_START;
+  }
+  _calActive = true;
+  _calFF = feedForward;
+  _calFailed = _calComplete = false;
+  interrupts();
+}
+
+void MD_SmartCar::runCalibrate(uint8_t motor, uint32_t now)
+// Run the calibration steps for one motor. The motor is
+// - ramped up from stop until it starts, to find the start PWM
+// - stepped up to the maximum PWM to find the top speed and, from the
+//   pulses lost while it accelerates, the time constant
+// - stepped down to a low PWM to find the speed at a second point
+// - ramped down from there until it stops, to find the stall PWM.
+{
+  motorData_t& md = _mData[motor];
+  SC_MotorEncoder::snapshot_t s;
+
+  switch (md.state)
+  {
+  case S_CAL_START:
+    if (now - md.timeLast < CAL_STEP_TIME)
+      break;
+
+    _E[motor]->snapshot(s);
+    if (labs(s.count - md.enc.count) >= CAL_START_COUNT)
+    {
+      // Started, so step to full power. Remember where the step
+      // starts to work out the time constant.
+      md.cal.pwmStart = md.co;
+      md.cal.ppsStep = abs(SC_MotorEncoder::calcSpeed(md.enc, s));
+      md.cal.count0 = s.count;
+      md.cal.time0 = s.time;
+      md.co = getMaxMotorSP();
+      md.cal.measure = false;
+      md.state = S_CAL_HIGH;
+      SCPRINT("\nCAL #", motor);
+      SCPRINT(" start ", md.cal.pwmStart);
+    }
+    else if (md.co >= getMaxMotorSP())
+    {
+      SCPRINT("\nCAL #", motor);
+      SCPRINTS(" did not start");
+      md.co = 0;
+      md.state = S_IDLE;
+      _calFailed = true;
+    }
+    else
+      md.co = (getMaxMotorSP() - md.co < CAL_PWM_STEP) ? getMaxMotorSP() : md.co + CAL_PWM_STEP;
+    md.enc = s;
+    md.timeLast = now;
+    _M[motor]->run(md.direction, md.co);
+    break;
+
+  case S_CAL_HIGH:
+  case S_CAL_LOW:
+    if (!md.cal.measure)
+    {
+      if (now - md.timeLast >= CAL_SETTLE_TIME)
+      {
+        _E[motor]->snapshot(md.enc);
+        md.cal.measure = true;
+        md.timeLast = now;
+      }
+      break;
+    }
+
+    if (now - md.timeLast < CAL_MEASURE_TIME)
+      break;
+
+    _E[motor]->snapshot(s);
+    if (md.state == S_CAL_HIGH)
+    {
+      int32_t count = labs(md.enc.count - md.cal.count0);
+      float t = (float)(md.enc.time - md.cal.time0) / 1000000.0;
+
+      // For a first order response the motor travels the distance it
+      // would have at full speed less (change in speed * time constant).
+      md.cal.ppsHigh = abs(SC_MotorEncoder::calcSpeed(md.enc, s));
+      if (md.cal.ppsHigh > md.cal.ppsStep)
+        md.cal.tau = ((md.cal.ppsHigh * t) - count) / (float)(md.cal.ppsHigh - md.cal.ppsStep);
+      if (md.cal.tau < 0.0) md.cal.tau = 0.0;
+
+      md.co = calLowSP(motor);
+      md.cal.measure = false;
+      md.state = S_CAL_LOW;
+      SCPRINT("\nCAL #", motor);
+      SCPRINT(" high ", md.cal.ppsHigh);
+      SCPRINT(" tau ", md.cal.tau);
+    }
+    else
+    {
+      md.cal.ppsLow = abs(SC_MotorEncoder::calcSpeed(md.enc, s));
+      md.state = S_CAL_STALL;
+      SCPRINT("\nCAL #", motor);
+      SCPRINT(" low ", md.cal.ppsLow);
+    }
+    md.enc = s;
+    md.timeLast = now;
+    _M[motor]->run(md.direction, md.co);
+    break;
+
+  case S_CAL_STALL:
+    if (now - md.timeLast < CAL_STEP_TIME)
+      break;
+
+    _E[motor]->snapshot(s);
+    if (s.count == md.enc.count || md.co < CAL_PWM_STEP)
+    {
+      // Stopped, so the last PWM step was the lowest that kept it turning
+      md.cal.pwmStall = md.co + CAL_PWM_STEP;
+      md.co = 0;
+      md.state = S_IDLE;
+      SCPRINT("\nCAL #", motor);
+      SCPRINT(" stall ", md.cal.pwmStall);
+    }
+    else
+      md.co -= CAL_PWM_STEP;
+    md.enc = s;
+    md.timeLast = now;
+    _M[motor]->run(md.direction, md.co);
+    break;
+
+  default: break;
+  }
+}
+
+void MD_SmartCar::calibrateDone(void)
+// All the motors have been measured, work out the new configuration
+{
+  float t = (float)_config.pidPeriod / (float)MS_PER_SEC;
+  uint8_t pwmStart = 0, pwmStall = 0;
+  uint16_t ppsMax = UINT16_MAX;
+
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    motorData_t& md = _mData[i];
+    float kv, lambda;
+
+    if (md.cal.ppsHigh <= md.cal.ppsLow)
+    {
+      _calFailed = true;
+      return;
+    }
+
+    // Motor speed is a straight line against PWM, which is also the 
+    // feed-forward model. The slope is the inverse of the motor gain.
+    kv = (float)(getMaxMotorSP() - calLowSP(i)) / (float)(md.cal.ppsHigh - md.cal.ppsLow);
+    if (_calFF)
+    {
+      _config.Kv[i] = kv;
+      _config.Ks[i] = getMaxMotorSP() - (kv * md.cal.ppsHigh);
+      if (_config.Ks[i] < 0.0) _config.Ks[i] = 0.0;
+    }
+
+    // PID gains by lambda tuning for a first order motor. The PID output 
+    // is calculated incrementally, so Kp works as the integral gain and 
+    // Kd as the proportional gain. The closed loop time constant lambda 
+    // can't usefully be shorter than the PID period, which also adds 
+    // about one period of delay.
+    lambda = (md.cal.tau > t) ? md.cal.tau : t;
+    _config.Kp[i] = kv / (lambda + t);
+    _config.Ki[i] = 0.0;
+    _config.Kd[i] = _config.Kp[i] * md.cal.tau;
+
+    // the vehicle needs the thresholds for the weakest motor
+    if (md.cal.pwmStart > pwmStart) pwmStart = md.cal.pwmStart;
+    if (md.cal.pwmStall > pwmStall) pwmStall = md.cal.pwmStall;
+    if (md.cal.ppsHigh < ppsMax) ppsMax = md.cal.ppsHigh;
+  }
+
+  _config.minPWM = pwmStall;
+  _config.kickerPWM = (pwmStart + CAL_PWM_MARGIN > _config.maxPWM) ? _config.maxPWM : pwmStart + CAL_PWM_MARGIN;
+  _config.movePWM = (_config.kickerPWM + CAL_PWM_MARGIN > _config.maxPWM) ? _config.maxPWM : _config.kickerPWM + CAL_PWM_MARGIN;
+
+  setPIDOutputLimits();
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    setPIDParameters(i);
+  setVehicleParameters(_ppr, ppsMax, _diaWheel, _lenBase, _lenAxle);
+  saveConfig();
+}
+
+bool MD_SmartCar::autoTune(uint8_t mtr, uint8_t vel, SC_PID::tuneRule_t rule)
+{
+  if (mtr >= MAX_MOTOR || vel == 0 || vel > 100)
+    return(false);
+
+  SCPRINT("\n** TUNE #", mtr);
+  SCPRINT(" v:", vel);
+  SCPRINT(" rule:", rule);
+
+  noInterrupts();     // tick() may be using the motors
+  _inSequence = false;
+  _seqQueued = 0;
+  _moveActive = false;
+  _calActive = false;
+  _tuneComplete &= ~(1 << mtr);
+  _mData[mtr].pid->stopTune();
+  _mData[mtr].direction = SC_DCMotor::DIR_FWD;
+  _mData[mtr].sp = (((uint32_t)_ppsMax * vel) << SPEED_FX_BITS) / 100;
+  _mData[mtr].tuneRule = rule;
+  _mData[mtr].state = S_TUNE_INIT;
+  interrupts();
+
+  return(true);
+}
+
+void MD_SmartCar::runTune(uint8_t motor, uint32_t now)
+// Run the motor under PID speed control until it has settled, then let 
+// the PID relay autotune take over until it has measured the oscillation.
+// The PID is run here rather than tick(), as the motor is not in a 
+// drive() state.
+{
+  motorData_t& md = _mData[motor];
+
+  switch (md.state)
+  {
+  case S_TUNE_INIT:
+    md.co = startSP(motor);
+    _M[motor]->run(md.direction, md.co);
+    md.pid->setMode(SC_PID::USER);
+    md.pid->reset();
+    md.vel.reset();
+    _E[motor]->reset();
+    md.timeTune = md.timeSettle = now;
+    md.timeLast = now;
+    md.state = S_TUNE_RUN;
+    break;
+
+  case S_TUNE_RUN:
+    if (now - md.timeLast < md.pid->getPIDPeriod())
+      break;
+
+    md.cv = md.vel.update(cmdDirection(motor, _E[motor]->readSpeed(true, SPEED_FX_BITS)));
+    md.pid->compute();
+    _M[motor]->run(md.direction, md.co);
+    md.timeLast = now;
+
+    switch (md.pid->getTuneState())
+    {
+    case SC_PID::TUNE_OFF:
+      {
+        // Noise band of half a pulse in a PID period, as the speed is 
+        // measured to about 1 pulse in a period. The relay needs to start 
+        // from the output that holds the set speed, so wait for the speed 
+        // to stay in the noise band for a while.
+        int16_t noise = ((uint32_t)MS_PER_SEC << SPEED_FX_BITS) / (2 * md.pid->getPIDPeriod());
+
+        if (abs(md.sp - md.cv) > noise)
+          md.timeSettle = now;
+        if (now - md.timeSettle >= TUNE_SETTLE_TIME)
+        {
+          if (!md.pid->startTune((getMaxMotorSP() - getMinMotorSP()) / TUNE_STEP_DIV, noise, TUNE_CYCLES))
+            md.state = S_IDLE;
+          SCPRINT("\nTUNE #", motor);
+          SCPRINT(" start bias ", md.co);
+        }
+        else if (now - md.timeTune >= TUNE_SETTLE_MAX)
+        {
+          SCPRINT("\nTUNE #", motor);
+          SCPRINTS(" did not settle");
+          md.state = S_IDLE;
+        }
+      }
+      break;
+
+    case SC_PID::TUNE_RUN:
+      break;
+
+    case SC_PID::TUNE_DONE:
+      {
+        float t = (float)md.pid->getPIDPeriod() / (float)MS_PER_SEC;
+        float Kp, Ki, Kd;
+
+        SCPRINT("\nTUNE #", motor);
+        SCPRINT(" Ku ", md.pid->getKu());
+        SCPRINT(" Pu ", md.pid->getPu());
+        if (md.pid->getTuneResult(md.tuneRule, Kp, Ki, Kd))
+        {
+          // SC_PID parameters are already scaled by the PID period
+          setPIDTuning(motor, Kp / t, Ki / t, Kd / t);
+          _tuneComplete |= (1 << motor);
+        }
+        md.state = S_IDLE;
+      }
+      break;
+
+    case SC_PID::TUNE_FAILED:
+      SCPRINT("\nTUNE #", motor);
+      SCPRINTS(" failed");
+      md.state = S_IDLE;
+      break;
+    }
+
+    if (md.state == S_IDLE)
+    {
+      md.pid->stopTune();
+      md.sp = md.co = 0;
+      _M[motor]->run(md.direction, md.co);
+    }
+    break;
+
+  default: break;
+  }
+}
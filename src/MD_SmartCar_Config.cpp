@@ -8,27 +8,43 @@
 
 void MD_SmartCar::loadConfig(void)
 {
+  // The per motor settings make the layout depend on the number of motors,
+  // so a 4 motor build has bit 7 of the second signature byte set.
+  const uint8_t sig1 = SIG[1] ^ ((MAX_MOTOR - 2) << 6);
+
   SCPRINTS("\nLoaded Config");
   EEPROM.get(EEPROM_ADDR - sizeof(_config), _config);
 
   // if not valid signature, load defaults
-  if (_config.sig[0] != SIG[0] || _config.sig[1] != SIG[1])
+  if (_config.sig[0] != SIG[0] || _config.sig[1] != sig1)
   {
     SCPRINTS(" - defaults");
     _config.sig[0] = SIG[0];
-    _config.sig[1] = SIG[1];
+    _config.sig[1] = sig1;
 
     _config.movePWM = MC_PWM_MOVE;
     _config.kickerPWM = MC_PWM_KICKER;
     _config.minPWM = MC_PWM_MIN;
     _config.maxPWM = MC_PWM_MAX;
     _config.spinAdjust = MC_SPIN_ADJUST;
+    _config.pidPeriod = PID_PERIOD;
+    _config.pidFilter = PID_FILTER;
+    _config.pidSlew = PID_SLEW;
+    _config.speedAlpha = SPEED_ALPHA;
+    _config.accelMax = MC_ACCEL_MAX;
+    _config.jerkMax = MC_JERK_MAX;
+    _config.moveVelocity = MC_MOVE_VELOCITY;
+    _config.posKp = MC_POS_KP;
+    _config.moveTolerance = MC_MOVE_TOLERANCE;
+    _config.syncKp = MC_SYNC_KP;
 
     for (uint8_t i = 0; i < MAX_MOTOR; i++)
     {
       _config.Kp[i] = DefKp;
       _config.Ki[i] = DefKi;
       _config.Kd[i] = DefKd;
+      _config.Ks[i] = DefKs;
+      _config.Kv[i] = DefKv;
     }
 
     saveConfig();
@@ -55,12 +71,21 @@ void MD_SmartCar::printConfig(void)
   SCPRINT("\nKicker PWM: ", _config.kickerPWM);
   SCPRINT("\nSpin Inertial: ", _config.spinAdjust);
   SCPRINT("\nPWM: ", _config.minPWM); SCPRINT(", ", _config.maxPWM);
+  SCPRINT("\nPID Period: ", _config.pidPeriod);
+  SCPRINT("\nPID Filter: ", _config.pidFilter); SCPRINT(", ", _config.pidSlew);
+  SCPRINT("\nSpeed Filter: ", _config.speedAlpha);
+  SCPRINT("\nProfile: ", _config.accelMax); SCPRINT(", ", _config.jerkMax);
+  SCPRINT("\nMove Velocity: ", _config.moveVelocity);
+  SCPRINT("\nPosition: ", _config.posKp); SCPRINT(", ", _config.moveTolerance);
+  SCPRINT("\nSync: ", _config.syncKp);
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
   {
     SCPRINT("\nPID", i);
     SCPRINT(": ", _config.Kp[i]);
     SCPRINT(", ", _config.Ki[i]);
     SCPRINT(", ", _config.Kd[i]);
+    SCPRINT(" FF ", _config.Ks[i]);
+    SCPRINT(", ", _config.Kv[i]);
   }
 
   SCPRINTS("\n------");
@@ -6,28 +6,78 @@
  */
 
 void MD_SmartCar::setLinearVelocity(int8_t vel)
+// drive() stops the vehicle if there is no lateral velocity either
 {
-  if (vel == 0)
-    stop();
-  else
-    drive(vel, _vAngular);
+  drive(vel, _vLateral, _vAngular);
+}
+
+int32_t MD_SmartCar::cmdDirection(uint8_t mtr, int32_t v)
+// Encoders that sense direction count negative in reverse, so change the 
+// sign to make the value relative to the commanded motor direction.
+// Single channel encoders always count in the commanded direction.
+{
+  if (_E[mtr]->hasDirection() && _mData[mtr].direction == SC_DCMotor::DIR_REV)
+    v = -v;
+
+  return(v);
+}
+
+int32_t MD_SmartCar::fwdDirection(uint8_t mtr, int32_t v)
+// Single channel encoders count up in either direction, so change
+// the sign for reverse to make the value positive moving forward.
+{
+  if (!_E[mtr]->hasDirection() && _mData[mtr].direction == SC_DCMotor::DIR_REV)
+    v = -v;
+
+  return(v);
+}
+
+int32_t MD_SmartCar::moveRemaining(uint8_t mtr)
+// Distance still to go for a move(), negative if past the target
+{
+  int32_t d = _mData[mtr].target - _mData[mtr].pos;
+
+  return(_mData[mtr].target < 0 ? -d : d);
 }
 
 bool MD_SmartCar::isRunning(void)
 // check if any of the motors are running
 {
-  bool b = true;
+  bool b = false;
 
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
-    b = b && _mData[i].state != S_IDLE;
+    b = b || _mData[i].state != S_IDLE;
 
   return(b);
 }
 
 void MD_SmartCar::setPIDOutputLimits(void)
 {
+  noInterrupts();     // tick() may be using the PID
   for (uint8_t i = 0; i < MAX_MOTOR; i++)
     _mData[i].pid->setOutputLimits(getMinMotorSP(), getMaxMotorSP());
+  interrupts();
+}
+
+void MD_SmartCar::setPIDParameters(uint8_t mtr)
+// The PID works on speeds in pulses per second but the tuning parameters 
+// are for speeds in pulses per PID period, so they work the same at any 
+// period. Scale the parameters by the period to convert the units.
+{
+  float t = (float)_config.pidPeriod / (float)MS_PER_SEC;
+
+  noInterrupts();     // tick() may be using the PID
+  _mData[mtr].pid->setPIDPeriod(_config.pidPeriod);
+  _mData[mtr].pid->setTuning(_config.Kp[mtr] * t, _config.Ki[mtr] * t, _config.Kd[mtr] * t);
+  _mData[mtr].pid->setFeedForward(_config.Ks[mtr], _config.Kv[mtr]);
+  _mData[mtr].pid->setDerivativeFilter((float)_config.pidFilter / (float)MS_PER_SEC);
+  _mData[mtr].pid->setOutputRate(_config.pidSlew);
+  _mData[mtr].pid->setValueScale(SPEED_FX_BITS);
+  _mData[mtr].vel.setAlpha((float)_config.speedAlpha / 100.0);
+  // position loop is proportional on measurement, already in pps per pulse
+  _mData[mtr].pidPos->setPIDPeriod(_config.pidPeriod);
+  _mData[mtr].pidPos->setTuning(_config.posKp, 0.0, 0.0, 0.0);
+  interrupts();
 }
 
 void MD_SmartCar::setPIDTuning(uint8_t mtr, float Kp, float Ki, float Kd)
@@ -37,7 +87,7 @@ void MD_SmartCar::setPIDTuning(uint8_t mtr, float Kp, float Ki, float Kd)
     _config.Kp[mtr] = Kp;
     _config.Ki[mtr] = Ki;
     _config.Kd[mtr] = Kd;
-    _mData[mtr].pid->setTuning(Kp, Ki, Kd);
+    setPIDParameters(mtr);
   }
 }
 
@@ -51,6 +101,120 @@ void MD_SmartCar::getPIDTuning(uint8_t mtr, float& Kp, float& Ki, float& Kd)
   }
 }
 
+void MD_SmartCar::setFeedForward(uint8_t mtr, float Ks, float Kv)
+{
+  if (mtr < MAX_MOTOR)
+  {
+    _config.Ks[mtr] = Ks;
+    _config.Kv[mtr] = Kv;
+    setPIDParameters(mtr);
+  }
+}
+
+void MD_SmartCar::getFeedForward(uint8_t mtr, float& Ks, float& Kv)
+{
+  if (mtr < MAX_MOTOR)
+  {
+    Ks = _config.Ks[mtr];
+    Kv = _config.Kv[mtr];
+  }
+}
+
+bool MD_SmartCar::setPIDPeriod(uint16_t period)
+{
+  if (period < PID_PERIOD_MIN || period > PID_PERIOD_MAX)
+    return(false);
+
+  _config.pidPeriod = period;
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    setPIDParameters(i);
+
+  return(true);
+}
+
+void MD_SmartCar::setPIDFilter(uint16_t filter, uint8_t slew)
+{
+  _config.pidFilter = filter;
+  _config.pidSlew = slew;
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    setPIDParameters(i);
+}
+
+bool MD_SmartCar::setSpeedFilter(uint8_t alpha)
+{
+  if (alpha == 0 || alpha > 100)
+    return(false);
+
+  _config.speedAlpha = alpha;
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    setPIDParameters(i);
+
+  return(true);
+}
+
+void MD_SmartCar::setProfileLimits(void)
+// Convert the profile limits from % of full scale to pps
+{
+  float accel = ((float)_config.accelMax * _ppsMax) / 100.0;
+  float jerk = ((float)_config.jerkMax * _ppsMax) / 100.0;
+
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    _mData[i].prof.setLimits(accel, jerk);
+}
+
+void MD_SmartCar::setMotionProfile(uint16_t accel, uint16_t jerk)
+{
+  _config.accelMax = accel;
+  _config.jerkMax = jerk;
+  setProfileLimits();
+}
+
+bool MD_SmartCar::setPositionGain(float Kp)
+{
+  if (Kp < 0.0)
+    return(false);
+
+  _config.posKp = Kp;
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    setPIDParameters(i);
+
+  return(true);
+}
+
+bool MD_SmartCar::setSyncGain(float Ks)
+{
+  if (Ks < 0.0)
+    return(false);
+
+  _config.syncKp = Ks;
+  return(true);
+}
+
+float MD_SmartCar::syncCorrection(uint8_t mtr, uint32_t now)
+// Cross-coupling between the wheels. The difference between this 
+// wheel's lag and the other wheel's is shared equally between them, 
+// so the wheel that is ahead slows down and the other speeds up.
+// All the wheels use the lags from the same (previous) PID step, so 
+// the result does not depend on the order the motors are processed.
+{
+  float c = 0.0;
+
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+    if (i != mtr)
+      c += _mData[mtr].lag - (_mData[i].timeLast == now ? _mData[i].lagLast : _mData[i].lag);
+
+  return((_config.syncKp * c) / MAX_MOTOR);
+}
+
+bool MD_SmartCar::setMoveVelocity(uint8_t vel)
+{
+  if (vel == 0 || vel > 100)
+    return(false);
+
+  _config.moveVelocity = vel;
+  return(true);
+}
+
 bool MD_SmartCar::setMoveSP(uint8_t units)
 {
   if (units >= _config.minPWM && units <= _config.maxPWM)
@@ -88,19 +252,26 @@ void MD_SmartCar::setMaxMotorSP(uint8_t units)
   setPIDOutputLimits(); 
 }
 
-void MD_SmartCar::setVehicleParameters(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase)
+void MD_SmartCar::setVehicleParameters(uint16_t ppr, uint16_t ppsMax, uint16_t dWheel, uint16_t lBase, uint16_t lAxle)
 {
   // save values
   _ppr = ppr;
   _ppsMax = ppsMax;
   _diaWheel = dWheel;
   _lenBase = lBase;
+  _lenAxle = lAxle;
 
   // now calculate derived constants
   _lenPerPulse = (PI * (float)_diaWheel) / (float)_ppr;   // distance traveled per encoder pulse
 
   _diaWheelP = _diaWheel / _lenPerPulse;   // wheel diameter converted to pulses
   _lenBaseP = _lenBase / _lenPerPulse;     // base length converted to pulses
+  if (_drivetrain == MECANUM)              // rollers turn about the wheel and axle centers
+    _lenBaseP = (_lenBase + _lenAxle) / _lenPerPulse;
+  setProfileLimits();                      // profiles limits depend on ppsMax
+#if POSE_FIXED_POINT
+  _kTheta = (2670176.86 / _lenBaseP) + 0.5;  // (2^24 / 2PI) / base length for odometry
+#endif
   SCPRINT("\nWheel dia (P): ", _diaWheelP);
   SCPRINT("\nBase Len (P): ", _lenBaseP);
 }
@@ -0,0 +1,130 @@
+#include <MD_SmartCar.h>
+
+/**
+ * \file
+ * \brief Code file for MD_SmartCar library class - pose odometry methods.
+ */
+
+#if POSE_FIXED_POINT
+// Quarter wave sine table, 64 steps over 90 degrees, Q14 fixed point (16384 = 1.0)
+static const int16_t PROGMEM sinTable[65] =
+{
+      0,   402,   804,  1205,  1606,  2006,  2404,  2801,
+   3196,  3590,  3981,  4370,  4756,  5139,  5520,  5897,
+   6270,  6639,  7005,  7366,  7723,  8076,  8423,  8765,
+   9102,  9434,  9760, 10080, 10394, 10702, 11003, 11297,
+  11585, 11866, 12140, 12406, 12665, 12916, 13160, 13395,
+  13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978,
+  15137, 15286, 15426, 15557, 15679, 15791, 15893, 15986,
+  16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379,
+  16384,
+};
+
+static int16_t sinFX(uint16_t a)
+// Sine of the binary angle a (65536 = full circle) in Q14 fixed point,
+// linearly interpolated from the quarter wave table.
+{
+  uint16_t p = a & 0x3fff;    // position in the quadrant
+  int16_t v;
+
+  if (a & 0x4000) p = 0x4000 - p;   // 2nd and 4th quadrants are mirrored
+  if (p == 0x4000)
+    v = pgm_read_word(&sinTable[64]);
+  else
+  {
+    int16_t v0 = pgm_read_word(&sinTable[p >> 8]);
+    int16_t v1 = pgm_read_word(&sinTable[(p >> 8) + 1]);
+
+    v = v0 + (((int32_t)(v1 - v0) * (p & 0xff)) >> 8);
+  }
+
+  return((a & 0x8000) ? -v : v);    // 3rd and 4th quadrants are negative
+}
+#endif
+
+void MD_SmartCar::resetPose(void)
+{
+  _poseX = _poseY = 0;
+  _poseTheta = 0;
+}
+
+void MD_SmartCar::getPose(float& x, float& y, float& theta)
+{
+#if POSE_FIXED_POINT
+  x = ((float)_poseX * _lenPerPulse) / 256.0;
+  y = ((float)_poseY * _lenPerPulse) / 256.0;
+  theta = (float)(int32_t)_poseTheta * (PI / 2147483648.0);
+#else
+  x = _poseX;
+  y = _poseY;
+  theta = _poseTheta;
+#endif
+}
+
+void MD_SmartCar::updatePose(void)
+// Integrate the wheel motion since the last update into the pose.
+// The heading changes by the difference in the wheel travel divided
+// by the base length and the vehicle moves by the average wheel travel,
+// in the direction of the heading at the midpoint of the motion.
+// With more than one motor each side the side travel is the average
+// for the side, and mecanum wheels also move the vehicle sideways.
+{
+  int32_t count[MAX_MOTOR];
+  int32_t cL = 0, cR = 0;
+  int32_t cLat = 0;
+  uint32_t time;
+
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    _E[i]->readDelta(_mData[i].odo, count[i], time);
+    count[i] = fwdDirection(i, count[i]);
+    if (isLeft(i)) cL += count[i];
+    else           cR += count[i];
+  }
+
+#if SC_MOTOR_COUNT == 4
+  // sideways travel from the mecanum rollers (see drive())
+  if (_drivetrain == MECANUM)
+    cLat = count[MLEFT] - count[MRIGHT] - count[MLEFT_REAR] + count[MRIGHT_REAR];
+#endif
+
+  if (cL == 0 && cR == 0 && cLat == 0)
+    return;
+
+#if POSE_FIXED_POINT
+  {
+    uint32_t dTheta = (uint32_t)(((cL - cR) * _kTheta) / SIDE_MOTOR) << 8;
+    uint16_t aMid = (_poseTheta + (uint32_t)((int32_t)dTheta / 2)) >> 16;
+    int32_t dCenter = ((cL + cR) * 128) / SIDE_MOTOR;   // average travel, Q8 pulses
+
+    _poseX += ((dCenter * sinFX(aMid + 0x4000)) + 8192) >> 14;
+    _poseY += ((dCenter * sinFX(aMid)) + 8192) >> 14;
+    if (cLat != 0)
+    {
+      int32_t dLat = cLat * 64;   // average sideways travel, Q8 pulses
+
+      _poseX -= ((dLat * sinFX(aMid)) + 8192) >> 14;
+      _poseY += ((dLat * sinFX(aMid + 0x4000)) + 8192) >> 14;
+    }
+    _poseTheta += dTheta;
+  }
+#else
+  {
+    float dTheta = (float)(cL - cR) / (_lenBaseP * SIDE_MOTOR);
+    float dCenter = ((float)(cL + cR) * _lenPerPulse) / (2.0 * SIDE_MOTOR);
+
+    _poseX += dCenter * cos(_poseTheta + (dTheta / 2.0));
+    _poseY += dCenter * sin(_poseTheta + (dTheta / 2.0));
+    if (cLat != 0)
+    {
+      float dLat = ((float)cLat * _lenPerPulse) / 4.0;   // average sideways travel
+
+      _poseX -= dLat * sin(_poseTheta + (dTheta / 2.0));
+      _poseY += dLat * cos(_poseTheta + (dTheta / 2.0));
+    }
+    _poseTheta += dTheta;
+    if (_poseTheta > PI) _poseTheta -= 2.0 * PI;
+    else if (_poseTheta <= -PI) _poseTheta += 2.0 * PI;
+  }
+#endif
+}
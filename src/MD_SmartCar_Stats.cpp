@@ -0,0 +1,115 @@
+#include <MD_SmartCar.h>
+
+/**
+ * \file
+ * \brief Code file for MD_SmartCar library class - loop timing instrumentation.
+ */
+
+void MD_SmartCar::setTimingStats(bool b)
+{
+  if (b) resetTimingStats();
+  _statsOn = b;
+}
+
+void MD_SmartCar::resetTimingStats(void)
+{
+  noInterrupts();     // tick() may be updating the PID statistics
+  memset(&_stats, 0, sizeof(_stats));
+  _statsRunAvg = _statsLoopAvg = 0;
+  _statsLateSum = 0;
+  _statsISR = 0;
+  _statsISRRate = 0;
+  _statsStart = millis();
+  interrupts();
+
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    _statsISRLast[i] = _E[i]->getISRCount();
+    _statsPIDLast[i] = 0;
+  }
+}
+
+void MD_SmartCar::getTimingStats(timingStats_t& stats)
+// The interrupt rate is measured from the last call (or reset), so it
+// shows the current load rather than an average since the reset.
+{
+  uint32_t now = millis();
+  uint32_t elapsed = now - _statsStart;
+
+  noInterrupts();     // tick() may be updating the PID statistics
+  stats = _stats;
+  stats.pidLateMean = (_stats.pidCount == 0) ? 0.0 : (float)_statsLateSum / (float)_stats.pidCount;
+  interrupts();
+
+  stats.runMean = (_statsRunAvg + 8) >> 4;
+  stats.loopMean = (_statsLoopAvg + 8) >> 4;
+  if (elapsed == 0)
+    stats.isrRate = _statsISRRate;    // called again straight away
+  else
+  {
+    _statsISRRate = ((float)_statsISR * (float)MS_PER_SEC) / (float)elapsed;
+    stats.isrRate = _statsISRRate;
+    _statsISR = 0;
+    _statsStart = now;
+  }
+}
+
+void MD_SmartCar::statsRun(uint32_t tStart)
+// Called at the end of run(). The averages are exponential moving 
+// averages (1/16 weight) kept in Q4 fixed point so they do not overflow 
+// however long the statistics run for. The first run() has no previous 
+// call to measure the gap from, so it starts the averages off.
+{
+  uint32_t tEnd = micros();
+  uint32_t tRun = tEnd - tStart;
+
+  if (_stats.runCount == 0)
+    _statsRunAvg = tRun << 4;
+  else
+  {
+    uint32_t tLoop = tStart - _statsRunEnd;
+
+    if (tLoop > _stats.loopMax) _stats.loopMax = tLoop;
+    if (_stats.runCount == 1)
+      _statsLoopAvg = tLoop << 4;
+    else
+      _statsLoopAvg = _statsLoopAvg - (_statsLoopAvg >> 4) + tLoop;
+    _statsRunAvg = _statsRunAvg - (_statsRunAvg >> 4) + tRun;
+  }
+  if (tRun > _stats.runMax) _stats.runMax = tRun;
+  _stats.runCount++;
+  _statsRunEnd = tEnd;
+
+  // encoder interrupts since the last run()
+  for (uint8_t i = 0; i < MAX_MOTOR; i++)
+  {
+    uint16_t n = _E[i]->getISRCount();
+
+    _statsISR += (uint16_t)(n - _statsISRLast[i]);
+    _statsISRLast[i] = n;
+  }
+}
+
+void MD_SmartCar::statsPID(uint8_t motor, uint32_t now)
+// Called just before the PID step time is updated, so timeLast is still
+// the time of the last step. Lateness is only measured from a previous
+// PID step - when a motor (re)starts, timeLast is set up by the state 
+// machine and there is no step to be late from. This may be called 
+// from tick().
+{
+  uint16_t period = _mData[motor].pid->getPIDPeriod();
+  int32_t late = 0;
+
+  if (_mData[motor].timeLast == _statsPIDLast[motor])
+  {
+    late = (int32_t)(now - _mData[motor].timeLast) - period;
+    if (late < 0) late = 0;     // timer driven tick() can be early by a ms
+    if (late > UINT16_MAX) late = UINT16_MAX;
+  }
+  _statsPIDLast[motor] = now;
+
+  _stats.pidCount++;
+  _statsLateSum += late;
+  if (late > _stats.pidLateMax) _stats.pidLateMax = late;
+  if (late >= period) _stats.pidMissed++;
+}
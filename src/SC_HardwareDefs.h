@@ -63,6 +63,18 @@ const uint8_t MC_PWM_KICKER = 60; ///< Kicker for drive() to overcome static fri
 const uint8_t MC_KICKER_ACTIVE = 100; ///< Kicker active time in milliseconds
 const float MC_SPIN_ADJUST = 0.75;    ///< Inertial adjustment for spin() operation
 
+// Default motion profile values, as percentage of maximum velocity (ppsMax)
+const uint16_t MC_ACCEL_MAX = 0;      ///< Acceleration limit in %/s (0 = no motion profile)
+const uint16_t MC_JERK_MAX = 0;       ///< Jerk limit in %/s/s (0 = trapezoidal profile)
+const uint8_t MC_MOVE_VELOCITY = 25;  ///< Velocity for profiled move() in %
+
+// Default move() position control values
+const float MC_POS_KP = 0.0;          ///< Position loop gain in pps per pulse of error (0 = open loop move())
+const uint8_t MC_MOVE_TOLERANCE = 1;  ///< Position tolerance in encoder pulses
+
+// Default wheel synchronization gain
+const float MC_SYNC_KP = 0.0;         ///< Cross-coupling gain in pps per pulse of difference (0 = off)
+
 // -----------------------------------
 // Motor Encoder
 //
@@ -75,12 +87,22 @@ const uint8_t EN_R_PIN = 2;    ///< Right Motor encoder interrupt pin
 const float DefKp = 1.50;    ///< PID proportional weighting default
 const float DefKi = 0.00;    ///< PID integral weighting default
 const float DefKd = 0.15;    ///< PID derivative weighting default
+const float DefKs = 0.00;    ///< Feed-forward static offset default (PWM, 0 = no feed-forward)
+const float DefKv = 0.00;    ///< Feed-forward slope default (PWM per pps)
+
+const uint16_t PID_FILTER = 0;        ///< Default PID derivative filter time constant in ms (0 = no filter)
+const uint8_t PID_SLEW = 0;           ///< Default PID output slew limit in PWM per PID period (0 = no limit)
+
+const uint8_t SPEED_FX_BITS = 4;      ///< Fraction bits of the fixed point speed PID set point and current value (pps)
+const uint8_t SPEED_ALPHA = 100;      ///< Default speed filter alpha gain in % (100 = no filtering)
 
-const uint16_t PID_PERIOD = 250;  ///< PID calculation period in ms
-const uint16_t MS_PER_SEC = 1000; ///< number of ms in 1 second
-const float PID_FREQ = ((float)MS_PER_SEC / (float)PID_PERIOD);  ///< whole divisor is better
+const uint16_t PID_PERIOD = 250;      ///< Default PID calculation period in ms
+const uint16_t PID_PERIOD_MIN = 5;    ///< Shortest allowed PID calculation period in ms
+const uint16_t PID_PERIOD_MAX = 1000; ///< Longest allowed PID calculation period in ms
+const uint16_t MS_PER_SEC = 1000;     ///< number of ms in 1 second
+const float PID_FREQ = ((float)MS_PER_SEC / (float)PID_PERIOD);  ///< default PID frequency, whole divisor is better
 
 // -----------------------------------
 // Configuration EEPROM settings
 const uint16_t EEPROM_ADDR = 1023;     ///< EEPROM config data ENDS at this address (ie saved below addr)
-const uint8_t SIG[2] = { 0xaa, 0x33 }; ///< EEPROM config signature bytes
+const uint8_t SIG[2] = { 0xaa, 0x3a }; ///< EEPROM config signature bytes, change when the config layout changes (SIG[1] < 0x80, bit 7 is set for 4 motor builds)
@@ -0,0 +1,100 @@
+/**
+ * \file
+ * \brief Class definition file for the SC_MotionProfile class.
+ */
+
+#include <SC_MotionProfile.h>
+
+SC_MotionProfile::SC_MotionProfile(float accel, float jerk)
+{
+  setLimits(accel, jerk);
+  reset();
+}
+
+void SC_MotionProfile::setLimits(float accel, float jerk)
+{
+  if (accel < 0.0 || jerk < 0.0)
+    return;
+
+  _accel = accel;
+  _jerk = jerk;
+}
+
+float SC_MotionProfile::stopVelocity(float dist)
+{
+  float k;
+
+  if (dist <= 0.0)
+    return(0.0);
+
+  if (_jerk == 0.0)
+    return(sqrt(2.0 * _accel * dist));
+
+  k = (_accel * _accel) / (2.0 * _jerk);
+  return(sqrt((k * k) + (2.0 * _accel * dist)) - k);
+}
+
+float SC_MotionProfile::next(float vTarget, float dt)
+{
+  float err = vTarget - _v;
+
+  if (_accel == 0.0)          // no limits
+  {
+    _v = vTarget;
+    _a = 0.0;
+  }
+  else if (_jerk == 0.0)      // trapezoidal
+  {
+    float dv = _accel * dt;
+
+    if (err > dv) err = dv;
+    else if (err < -dv) err = -dv;
+
+    _a = err / dt;
+    _v += err;
+  }
+  else                        // S-curve
+  {
+    // Velocity change while the acceleration is ramped back to zero. If
+    // that would take us past the target, start reducing acceleration now.
+    float dvStop = (_a * fabs(_a)) / (2.0 * _jerk);
+    float aWant = (err - dvStop > 0.0) ? _accel : -_accel;
+    float da = _jerk * dt;
+
+    if (aWant - _a > da) _a += da;
+    else if (aWant - _a < -da) _a -= da;
+    else _a = aWant;
+
+    _v += _a * dt;
+
+    // stop exactly at the target rather than hunting around it
+    if ((err >= 0.0 && _v >= vTarget) || (err <= 0.0 && _v <= vTarget))
+    {
+      _v = vTarget;
+      _a = 0.0;
+    }
+  }
+
+  return(_v);
+}
+
+float SC_MotionProfile::next(float vTarget, float dt, float dist)
+// Follow the normal profile, but never faster than the velocity that
+// can still decelerate to a stop in the distance remaining.
+{
+  float vLast = _v;
+
+  next(vTarget, dt);
+  if (_accel != 0.0)
+  {
+    float vStop = stopVelocity(dist);
+
+    if (_v > vStop)
+    {
+      _v = vStop;
+      _a = (_v - vLast) / dt;
+    }
+  }
+
+  return(_v);
+}
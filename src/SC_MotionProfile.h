@@ -0,0 +1,179 @@
+#pragma once
+/**
+ * \file
+ * \brief Header file for the SC_MotionProfile class of the MD_SmartCar library.
+ */
+
+/**
+ \page pageMotionProfile Motion Profiles
+
+ ## SmartCar Motion Profiles
+
+ Changing the speed setpoint of a motor in one step asks the PID controller
+ for an instant change in velocity. The motor responds with full power, which
+ can make the wheels slip and the vehicle lurch, and a move() that is stopped
+ at speed will overshoot its target.
+
+ A motion profile limits how fast the setpoint can change. Every PID period the
+ setpoint is moved towards the target velocity by no more than the acceleration
+ limit allows. The velocity follows a trapezoid shape (ramp up, constant speed,
+ ramp down).
+
+ If a jerk (rate of change of acceleration) limit is also set, the acceleration
+ itself is ramped up and down and the velocity follows an 'S' curve. This is
+ smoother for the vehicle but takes a little longer to reach the target velocity.
+
+ When the profile is given the distance remaining to the end of a movement it
+ also limits the velocity so that the vehicle can decelerate to a stop at
+ the target position. For an acceleration limit A and distance remaining d, the
+ highest velocity that can still stop in time is
+
+ v = sqrt(2Ad)
+
+ and when the jerk is limited to J, allowing for the time to ramp up the
+ deceleration,
+
+ v = sqrt(A<sup>4</sup>/4J<sup>2</sup> + 2Ad) - A<sup>2</sup>/2J
+
+ The profile is recalculated from the remaining distance every step, so it will
+ correct for the motor lagging behind or getting ahead of the profile.
+
+ Motion profiles are off by default (MC_ACCEL_MAX is 0), so drive(), move() and 
+ spin() keep their original timing. They are turned on by setting an acceleration 
+ limit with MD_SmartCar::setMotionProfile(), which can be saved in the EEPROM
+ configuration. A profile makes drive() reach its speed more gently, and so more
+ slowly, and stops move() without overshooting.
+
+ The _Mathematics of Motion Profiles_ paper in the library extras folder has a
+ complete explanation of trapezoidal and S-curve profiles.
+ */
+
+#include <Arduino.h>
+
+/**
+ * Core object for the SC_MotionProfile class
+ * Generates acceleration and jerk limited velocity setpoints.
+ */
+class SC_MotionProfile
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class. The profile starts at
+   * rest with no limits set.
+   *
+   * \param accel Acceleration limit in units/s/s. 0 for no limit.
+   * \param jerk  Jerk limit in units/s/s/s. 0 for no limit (trapezoidal profile).
+   */
+  SC_MotionProfile(float accel = 0.0, float jerk = 0.0);
+
+  /**
+   * Class Destructor.
+   *
+   * Release any allocated memory and clean up anything else.
+   */
+  ~SC_MotionProfile(void) {}
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+   * @{
+   */
+  /**
+   * Set the profile limits.
+   *
+   * Set the acceleration and jerk limits for the profile. Units are
+   * the velocity units per second (acceleration) and per second per
+   * second (jerk).
+   *
+   * If the acceleration is 0 there are no limits and the velocity
+   * changes straight to the target. If the jerk is 0 the profile is
+   * trapezoidal.
+   *
+   * \param accel the acceleration limit.
+   * \param jerk  the jerk limit.
+   */
+  void setLimits(float accel, float jerk);
+
+  /**
+   * Reset the profile.
+   *
+   * Set the current velocity, with no acceleration.
+   *
+   * \param v the current velocity.
+   */
+  void reset(float v = 0.0) { _v = v; _a = 0.0; }
+
+  /**
+   * Calculate the next velocity setpoint.
+   *
+   * Move the velocity towards the target without exceeding the limits.
+   *
+   * \param vTarget the target velocity.
+   * \param dt      the time step in seconds.
+   * \return the velocity setpoint for this step.
+   */
+  float next(float vTarget, float dt);
+
+  /**
+   * Calculate the next velocity setpoint for a movement to a position.
+   *
+   * Move the velocity towards the target without exceeding the limits,
+   * also limiting it so that the movement can decelerate to a stop in the
+   * distance remaining. The movement is in the positive direction, so
+   * vTarget should be positive.
+   *
+   * \param vTarget the target velocity.
+   * \param dt      the time step in seconds.
+   * \param dist    the distance remaining to the target position.
+   * \return the velocity setpoint for this step.
+   */
+  float next(float vTarget, float dt, float dist);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Utility Functions.
+   * @{
+   */
+  /**
+   * Return the current velocity setpoint.
+   *
+   * \return The velocity calculated at the last step.
+   */
+  inline float getVelocity(void) { return(_v); }
+
+  /**
+   * Return the current acceleration.
+   *
+   * \return The acceleration calculated at the last step.
+   */
+  inline float getAcceleration(void) { return(_a); }
+
+  /**
+   * Return the acceleration limit.
+   *
+   * \return The acceleration limit, 0 if unlimited.
+   */
+  inline float getAccelLimit(void) { return(_accel); }
+
+  /**
+   * Return the jerk limit.
+   *
+   * \return The jerk limit, 0 if unlimited.
+   */
+  inline float getJerkLimit(void) { return(_jerk); }
+  /** @} */
+
+private:
+  float _accel;   ///< acceleration limit (0 = unlimited)
+  float _jerk;    ///< jerk limit (0 = unlimited)
+  float _v;       ///< current velocity
+  float _a;       ///< current acceleration
+
+  float stopVelocity(float dist);   ///< highest velocity that can stop in dist
+};
@@ -8,80 +8,266 @@
 
 SC_MotorEncoder::~SC_MotorEncoder(void)
 {
-  if (_pinInt != NO_PIN)
-    detachInterrupt(digitalPinToInterrupt(_pinInt));
-  _ISRAlloc &= ~_BV(_myISRId);   // free up the ISR slot for someone else
+  detachPin(_pinInt);
+  _ISRAlloc &= ~_myISRs;   // free up the ISR slots for someone else
 }
 
 bool SC_MotorEncoder::begin(void)
 {
-  int8_t irq = digitalPinToInterrupt(_pinInt);
-
-  if (irq == NOT_AN_INTERRUPT)
+  if (!attachPin(_pinInt))
     _pinInt = NO_PIN;
   else
-  {
-    pinMode(_pinInt, INPUT_PULLUP);
+    initCounters();
+
+  return(_pinInt != NO_PIN);
+}
+
+void SC_MotorEncoder::initCounters(void)
+{
+  _period = 0;
+  _timeEdge = micros();
+  _counter = 0;
+  _isrCount = 0;
+  reset();
+}
+
+bool SC_MotorEncoder::attachPin(uint8_t pin)
+// Allocate a free ISR slot to this instance and attach it to the pin.
+// Return false if the pin cannot interrupt or there are no free slots.
+{
+  int8_t irq = digitalPinToInterrupt(pin);
+  uint8_t id = UINT8_MAX;
 
-    // assign ourselves a ISR ID ...
-    _myISRId = UINT8_MAX;
-    for (uint8_t i = 0; i < MAX_ISR; i++)
+  if (pin == NO_PIN || irq == NOT_AN_INTERRUPT)
+    return(false);
+
+  pinMode(pin, INPUT_PULLUP);
+
+  // assign ourselves a ISR ID ...
+  for (uint8_t i = 0; i < MAX_ISR; i++)
+  {
+    if (!(_ISRAlloc & _BV(i)))    // found a free ISR Id?
     {
-      if (!(_ISRAlloc & _BV(i)))    // found a free ISR Id?
-      {
-        _myISRId = i;                 // remember who this instance is
-        _myInstance[_myISRId] = this; // record this instance
-        _ISRAlloc |= _BV(_myISRId);   // lock this in the allocations table
-        break;
-      }
+      id = i;
+      _myInstance[id] = this;     // record this instance
+      _ISRAlloc |= _BV(id);       // lock this in the allocations table
+      _myISRs |= _BV(id);         // and remember it is ours
+      break;
     }
+  }
 
-    //Serial.print("\nPin ");             Serial.print(_pinInt);
-    //Serial.print(" (irq ");             Serial.print(irq);
-    //Serial.print(") assigned ISR Id "); Serial.print(_myISRId);
-    //Serial.print(", ISRAlloc 0b");      Serial.print(_ISRAlloc, BIN);
+  //Serial.print("\nPin ");             Serial.print(pin);
+  //Serial.print(" (irq ");             Serial.print(irq);
+  //Serial.print(") assigned ISR Id "); Serial.print(id);
+  //Serial.print(", ISRAlloc 0b");      Serial.print(_ISRAlloc, BIN);
 
-    // ... and attach corresponding ISR callback from the lookup table
+  // ... and attach corresponding ISR callback from the lookup table
+  {
+    static void (*ISRfunc[MAX_ISR])(void) =
     {
-      static void((*ISRfunc[MAX_ISR])(void)) =
-      {
-        encoderISR0, encoderISR1, encoderISR2, encoderISR3,
-        encoderISR4, encoderISR5, encoderISR6, encoderISR7,
-      };
-
-      if (_myISRId != UINT8_MAX)
-        attachInterrupt(irq, ISRfunc[_myISRId], CHANGE);
-      else
-        _pinInt = NO_PIN;
-    }
+      encoderISR0, encoderISR1, encoderISR2, encoderISR3,
+      encoderISR4, encoderISR5, encoderISR6, encoderISR7,
+    };
 
-    reset();
+    if (id == UINT8_MAX)
+      return(false);
+
+    attachInterrupt(irq, ISRfunc[id], CHANGE);
   }
 
-  return(_pinInt != NO_PIN);
+  return(true);
+}
+
+void SC_MotorEncoder::detachPin(uint8_t pin)
+{
+  if (pin != NO_PIN)
+    detachInterrupt(digitalPinToInterrupt(pin));
 }
 
 void SC_MotorEncoder::reset(void)
 {
   if (_pinInt != NO_PIN)
+    snapshot(_snap);
+}
+
+void SC_MotorEncoder::snapshot(snapshot_t& s)
+// Seqlock style read - the ISR changes _seq every time it updates
+// the data, so copy until we get a set that was not interrupted.
+// _seq is a single byte so it is always read atomically.
+{
+  uint8_t seq;
+
+  do
   {
-    _timeLast = millis();
-    _counter = 0;
-  }
+    seq = _seq;
+    s.time = micros();
+    s.count = _counter;
+    s.timeEdge = _timeEdge;
+    s.period = _period;
+  } while (seq != _seq);
+}
+
+uint32_t SC_MotorEncoder::getPeriod(void)
+// Same seqlock read as snapshot(), as the ISR may change the 32 bit value
+// part way through reading it
+{
+  uint8_t seq;
+  uint32_t p;
+
+  do
+  {
+    seq = _seq;
+    p = _period;
+  } while (seq != _seq);
+
+  return(p);
+}
+
+uint16_t SC_MotorEncoder::getISRCount(void)
+// Same seqlock read as snapshot(), as a 16 bit value is not read atomically
+{
+  uint8_t seq;
+  uint16_t n;
+
+  do
+  {
+    seq = _seq;
+    n = _isrCount;
+  } while (seq != _seq);
+
+  return(n);
+}
+
+void SC_MotorEncoder::readDelta(snapshot_t& last, int32_t& count, uint32_t& elapsed)
+{
+  snapshot_t now;
+
+  snapshot(now);
+  count = now.count - last.count;
+  elapsed = now.time - last.time;
+  last = now;
 }
 
 void SC_MotorEncoder::read(uint32_t& interval, uint16_t& count, bool bReset)
 {
   if (_pinInt != NO_PIN)
   {
-    count = _counter;
-    interval = millis() - _timeLast;
+    snapshot_t now;
 
-    if (bReset) reset();
+    snapshot(now);
+    count = labs(now.count - _snap.count);
+    interval = (now.time - _snap.time) / 1000UL;
+
+    if (bReset) _snap = now;
   }
 }
 
-void SC_MotorEncoder::handleISR(void) { _counter++; }  ///< Instance ISR handler called from static ISR encoderISRx
+int16_t SC_MotorEncoder::readSpeed(bool bReset, uint8_t fxBits)
+{
+  int16_t pps = 0;
+
+  if (_pinInt != NO_PIN)
+  {
+    snapshot_t now;
+
+    snapshot(now);
+    pps = calcSpeed(_snap, now, fxBits);
+
+    if (bReset) _snap = now;
+  }
+
+  return(pps);
+}
+
+int16_t SC_MotorEncoder::calcSpeed(const snapshot_t& last, const snapshot_t& now, uint8_t fxBits)
+{
+  uint32_t pps = 0;
+  int32_t delta = now.count - last.count;
+  uint32_t count = labs(delta);
+  uint32_t sinceEdge = now.time - now.timeEdge;
+
+  if (count >= SPEED_COUNT_MIN)
+  {
+    // Count based. The count is exactly the number of edges after the 
+    // previous snapshot's last edge up to this one, so use the time 
+    // between these edges.
+    uint32_t interval = now.timeEdge - last.timeEdge;
+
+    count <<= fxBits;
+
+    // keep within 32 bit arithmetic
+    if (count < (UINT32_MAX / 1000000UL))
+      pps = (count * 1000000UL) / interval;
+    else
+      pps = (count * 1000UL) / (interval / 1000UL);
+  }
+  else if (now.period != 0 && sinceEdge < SPEED_TIMEOUT)
+  {
+    // Period based - if the next edge is already overdue 
+    // the wheel is slowing down, so use the elapsed time
+    uint32_t period = now.period;
+
+    if (sinceEdge > period) period = sinceEdge;
+    pps = (1000000UL << fxBits) / period;
+  }
+
+  if (pps > INT16_MAX) pps = INT16_MAX;
+
+  return(delta < 0 ? -(int16_t)pps : (int16_t)pps);
+}
+
+void SC_MotorEncoder::recordEdge(int8_t delta)
+// Called from the ISR to record an edge that moved the count by delta.
+{
+  uint32_t now = micros();
+
+  _period = now - _timeEdge;
+  _timeEdge = now;
+  _counter += delta;
+  _seq++;
+}
+
+void SC_MotorEncoder::handleISR(void) { _isrCount++; recordEdge(1); }  ///< Instance ISR handler called from static ISR encoderISRx
+
+// --- Quadrature encoder
+bool SC_MotorEncoderQuad::begin(void)
+{
+  if (!attachPin(_pinInt) || !attachPin(_pinB))
+  {
+    detachPin(_pinInt);
+    detachPin(_pinB);
+    _ISRAlloc &= ~_myISRs;
+    _myISRs = 0;
+    _pinInt = NO_PIN;
+  }
+  else
+  {
+    _state = readState();
+    initCounters();
+  }
+
+  return(_pinInt != NO_PIN);
+}
+
+void SC_MotorEncoderQuad::handleISR(void)
+// Decode the transition from the previous to the current state.
+// Invalid transitions (both pins changed) and no change are ignored.
+{
+  static const int8_t QEM[16] =
+  {   // index is (previous state << 2) | current state
+    0, -1,  1,  0,
+    1,  0,  0, -1,
+   -1,  0,  0,  1,
+    0,  1, -1,  0
+  };
+  uint8_t state = readState();
+  int8_t delta = QEM[(_state << 2) | state];
+
+  _isrCount++;
+  _state = state;
+  if (delta != 0) recordEdge(delta);
+  else _seq++;      // getISRCount() still needs to see the change
+}
 
 // Interrupt handling declarations required outside the class
 uint8_t SC_MotorEncoder::_ISRAlloc = 0;     ///< allocation table for the encoderISRx()
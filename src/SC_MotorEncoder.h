@@ -27,6 +27,49 @@ when there is no signal from the detector.
 
 The output of the circuit needs to be connected to a pin that supports interrupts. 
 On the Arduino Uno/Nano this is pin 2 or 3.
+
+## Speed Measurement
+
+The encoder interrupt records the micros() timestamp of each pulse edge as well
+as counting the pulses, so speed can be measured in two ways:
+- _Count based_ - the number of pulses over a known time interval. This is
+  accurate at high speed but at low speed only a few pulses are counted in 
+  each interval and the reading jumps between a few discrete values.
+- _Period based_ - the time between the last two pulse edges. This has 
+  microsecond resolution and is accurate at low speed, but becomes noisy at 
+  high speed when the pulse period is short.
+
+SC_MotorEncoder::readSpeed() combines the two, using the count when there are
+at least SPEED_COUNT_MIN pulses in the interval and the edge period otherwise.
+If no edge has been seen for SPEED_TIMEOUT the wheel is considered stopped.
+## Reading the Encoder
+
+The pulse counter is never cleared once the encoder is running. The interrupt 
+handler only ever adds to it and each reader keeps its own snapshot_t of the
+last values read, calculating the number of pulses and elapsed time since then
+by subtraction. This means that any number of readers can share the one 
+encoder and no pulse is ever lost between a read and a reset.
+
+Multi-byte values are not read atomically on 8 bit processors, so the 
+interrupt handler increments a single byte sequence number every time it 
+updates the encoder data. SC_MotorEncoder::snapshot() copies the data and 
+repeats the copy if the sequence number changed while it was copying. This
+gives a consistent count and time stamp without disabling interrupts.
+
+## Quadrature Encoders
+
+A single channel encoder cannot tell which way the wheel is turning, so the
+count always increases and MD_SmartCar applies the direction it commanded.
+SC_MotorEncoderQuad uses both outputs (A and B) of a quadrature encoder, each 
+on its own interrupt pin. Every change on either output is decoded from the 
+previous and current A/B state, so the count is signed and there are 
+4 counts per encoder cycle (set ppr in MD_SmartCar::begin() accordingly). 
+Invalid transitions (eg, from contact bounce) are ignored.
+
+SC_MotorEncoder::hasDirection() returns true for encoders that provide signed 
+counts, and MD_SmartCar then uses the encoder sign rather than the commanded 
+direction. This makes reversals and overshoot visible to the speed and 
+position control.
 */
 #include <Arduino.h>
 
@@ -43,6 +86,28 @@ On the Arduino Uno/Nano this is pin 2 or 3.
 class SC_MotorEncoder
 {
 public:
+  //--------------------------------------------------------------
+  /** \name Structures, Enumerated Types and Constants.
+   * @{
+   */
+  /**
+   * Encoder snapshot.
+   *
+   * A consistent copy of the encoder data taken at one instant by snapshot().
+   */
+  typedef struct
+  {
+    int32_t count;      ///< free running pulse count (signed)
+    uint32_t time;      ///< micros() time the snapshot was taken
+    uint32_t timeEdge;  ///< micros() time of the last pulse edge included in count
+    uint32_t period;    ///< time between the last two pulse edges in us (0 if not known)
+  } snapshot_t;
+
+  static const uint8_t SPEED_COUNT_MIN = 4;         ///< readSpeed() min pulses for count based reading
+  static const uint32_t SPEED_TIMEOUT = 500000;     ///< readSpeed() time in us with no edge to read 0 speed
+
+  /** @} */
+
   //--------------------------------------------------------------
   /** \name Class constructor and destructor.
    * @{
@@ -58,14 +123,14 @@ public:
    * \param pinInt The interrupt pin for the encoder. This is digital 
    * pin that supports interrupts.
    */
-  SC_MotorEncoder(uint8_t pinInt) : _pinInt(pinInt) {}
+  SC_MotorEncoder(uint8_t pinInt) : _pinInt(pinInt), _myISRs(0) {}
 
   /**
    * Class Destructor.
    *
    * Release any allocated memory and clean up anything else.
    */
-  ~SC_MotorEncoder(void);
+  virtual ~SC_MotorEncoder(void);
   /** @} */
 
   //--------------------------------------------------------------
@@ -80,20 +145,61 @@ public:
    *
    * \return false if the pin specified is not an interrupt pin.
    */
-  bool begin(void);
+  virtual bool begin(void);
+
+  /**
+   * Check if the encoder senses direction.
+   *
+   * A single channel encoder only counts up, so the direction of rotation 
+   * must be inferred from the direction the motor is driven. Encoders that
+   * sense direction return signed counts and speeds.
+   *
+   * \return true if counts are signed by the direction of rotation.
+   */
+  virtual bool hasDirection(void) { return(false); }
 
   /**
    * Reset the encoder.
    *
-   * This sets the encoder counter back to 0 and the the time marker to 'now'.
+   * This sets the counts returned by read() and readSpeed() back to 0 and the 
+   * time marker to 'now'. The free running pulse count is not changed.
    */
   void reset(void);
 
+  /**
+   * Take a snapshot of the encoder data.
+   *
+   * Copies the free running count, last edge time and period into the 
+   * snapshot as one consistent set, together with the time it was taken.
+   * This is safe to call with interrupts running and does not disable them.
+   *
+   * \sa readDelta()
+   *
+   * \param s the snapshot to fill in.
+   */
+  void snapshot(snapshot_t& s);
+
+  /**
+   * Read the encoder change since a previous snapshot.
+   *
+   * Takes a new snapshot and returns the number of pulses counted and 
+   * the time elapsed since the previous snapshot, which is then replaced 
+   * by the new one. Every pulse is counted in exactly one call.
+   *
+   * \sa snapshot()
+   *
+   * \param last    the previous snapshot, updated to the new snapshot.
+   * \param count   variable for the (signed) number of pulses since the last snapshot.
+   * \param elapsed variable for the time since the last snapshot in microseconds.
+   */
+  void readDelta(snapshot_t& last, int32_t& count, uint32_t& elapsed);
+
   /**
    * Read encoder values.
    *
    * Returns the encoder accumulated count and the time period over which it was
-   * accumulated and resets the registers if required.
+   * accumulated and resets the registers if required. The count is the number of
+   * pulses irrespective of direction.
    * 
    * \param interval variable for the time interval.
    * \param count    variable for the accumulator count.
@@ -101,21 +207,84 @@ public:
    */
   void read(uint32_t& interval, uint16_t& count, bool bReset = true);
 
+  /**
+   * Read encoder speed.
+   *
+   * Returns the current encoder speed in pulses per second. The reading is
+   * count based if at least SPEED_COUNT_MIN pulses have been counted since 
+   * the last reset, otherwise it is based on the time between the last two 
+   * pulse edges.
+   *
+   * Both methods resolve a fraction of a pulse per second, so the speed can
+   * be returned as a fixed point number with fxBits fraction bits (eg, 4 
+   * returns 1/16ths of a pulse per second). The largest speed that can be
+   * returned is INT16_MAX >> fxBits pulses per second.
+   *
+   * \sa getPeriod()
+   *
+   * \param bReset if true (default) reset the counters, otherwise leave them as they are.
+   * \param fxBits number of fraction bits in the result (default 0, whole pulses per second).
+   * \return the speed in encoder pulses per second, negative for reverse if hasDirection().
+   */
+  int16_t readSpeed(bool bReset = true, uint8_t fxBits = 0);
+
+  /**
+   * Calculate speed between two snapshots.
+   *
+   * Returns the speed in pulses per second from the pulses counted 
+   * between two snapshots, using the same method as readSpeed().
+   *
+   * \param last the earlier snapshot.
+   * \param now  the later snapshot.
+   * \param fxBits number of fraction bits in the result (default 0, whole pulses per second).
+   * \return the speed in encoder pulses per second, negative if the count went down.
+   */
+  static int16_t calcSpeed(const snapshot_t& last, const snapshot_t& now, uint8_t fxBits = 0);
+
+  /**
+   * Get the last pulse period.
+   *
+   * Returns the time between the last two pulse edges detected.
+   *
+   * \return the pulse period in microseconds, 0 if not yet measured.
+   */
+  uint32_t getPeriod(void);
+
+  /**
+   * Get the interrupt count.
+   *
+   * Returns a free running count of the encoder interrupts. This includes
+   * interrupts that did not change the pulse count (eg, contact bounce on
+   * a quadrature encoder), so the rate it changes at is the interrupt load
+   * from this encoder.
+   *
+   * \return the number of interrupts handled, wrapping around at 65536.
+   */
+  uint16_t getISRCount(void);
+
   /** @} */
 
-private:
+protected:
   // Define the class variables
   uint8_t _pinInt;            ///< The interrupt pin in use
-  uint8_t _ppr;               ///< The configured pulses per revolution
-  uint32_t _timeLast;         ///< Keep track of when the counter was reset
-  uint8_t _myISRId;           ///< This is my instance ISR Id for myInstance[x] and encoderISRx
-  volatile uint16_t _counter; ///< Encoder interrupt counter
+  uint8_t _myISRs;            ///< Bit field of the ISR slots (myInstance[x] and encoderISRx) owned by this instance
+  snapshot_t _snap;           ///< Snapshot at the last reset for read() and readSpeed()
+  volatile uint8_t _seq;      ///< Changed by the ISR every time it updates the encoder data
+  volatile int32_t _counter;  ///< Encoder interrupt counter (free running)
+  volatile uint32_t _timeEdge;///< micros() time of the last pulse edge
+  volatile uint32_t _period;  ///< time between the last two pulse edges in us
+  volatile uint16_t _isrCount;///< Encoder interrupts handled (free running)
 
   static uint8_t _ISRAlloc;              ///< Keep track of which ISRs are used (global bit field)
   static SC_MotorEncoder* _myInstance[]; ///< callback instance for the ISR to reach handleISR()
 
-  void handleISR(void);       ///< Instance ISR handler called from static ISR encoderISRx
+  bool attachPin(uint8_t pin);   ///< Allocate an ISR slot and attach it to the pin
+  void detachPin(uint8_t pin);   ///< Detach the interrupt from the pin
+  void initCounters(void);       ///< Initialize the counters and edge timing
+  void recordEdge(int8_t delta); ///< Record an edge that changes the count by delta (called from ISR)
+  virtual void handleISR(void);  ///< Instance ISR handler called from static ISR encoderISRx
 
+private:
   // declare all the [MAX_ISR] encoder ISRs
   static void encoderISR0(void);
   static void encoderISR1(void);
@@ -126,3 +295,70 @@ private:
   static void encoderISR6(void);
   static void encoderISR7(void);
 };
+
+/**
+ * Core object for the SC_MotorEncoderQuad class
+ *
+ * This class extends SC_MotorEncoder for quadrature encoders, which 
+ * have two outputs (A and B) 90 degrees out of phase. Every edge on either
+ * output is counted (4x decoding) and the order of the edges gives the 
+ * direction of rotation, so counts and speeds are signed.
+ *
+ * Both pins need to support interrupts and each uses one of the MAX_ISR
+ * ISR slots. If the count goes down when the wheel turns forward, swap 
+ * the A and B pins.
+ */
+class SC_MotorEncoderQuad : public SC_MotorEncoder
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class.
+   *
+   * \param pinA The interrupt pin for the encoder A output.
+   * \param pinB The interrupt pin for the encoder B output.
+   */
+  SC_MotorEncoderQuad(uint8_t pinA, uint8_t pinB) : SC_MotorEncoder(pinA), _pinB(pinB) {}
+
+  /**
+   * Class Destructor.
+   *
+   * Release any allocated memory and clean up anything else.
+   */
+  ~SC_MotorEncoderQuad(void) { detachPin(_pinB); }
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+   * @{
+   */
+  /**
+   * Initialize the object.
+   *
+   * Initialize the object data. This needs to be called during setup() to reset new
+   * data for the class that cannot be done during the object creation.
+   *
+   * \return false if either pin is not an interrupt pin or there are no free ISR slots.
+   */
+  bool begin(void);
+
+  /**
+   * Check if the encoder senses direction.
+   *
+   * \return true, quadrature encoders always sense direction.
+   */
+  bool hasDirection(void) { return(true); }
+  /** @} */
+
+protected:
+  uint8_t _pinB;            ///< The interrupt pin for the B output
+  volatile uint8_t _state;  ///< Last A/B state as (A << 1) | B
+
+  inline uint8_t readState(void) { return((digitalRead(_pinInt) << 1) | digitalRead(_pinB)); }  ///< Read the current A/B state
+  void handleISR(void);     ///< Decode the quadrature transition
+};
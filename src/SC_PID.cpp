@@ -7,10 +7,11 @@
 
 SC_PID::SC_PID(int16_t* cv, int16_t* co, int16_t* sp,
                float Kp, float Ki, float Kd, float pOn, control_t control):
-    _pOn(pOn), _mode(OFF), _cv(cv), _co(co), _sp(sp), _pidPeriod(100)
+    _pOn(pOn), _ks(0.0), _kv(0.0), _tf(0.0), _dAlpha(256), _outRate(0), _vBits(0), _mode(OFF), _cv(cv), _co(co), _sp(sp), _pidPeriod(100), _tune(nullptr)
 {
   setOutputLimits(0, 255);
   setTuning(Kp, Ki, Kd, pOn);
+  setFeedForward(0.0, 0.0);
   setControlType(control);
 
   _lastTime = millis() - _pidPeriod;
@@ -22,18 +23,68 @@ bool SC_PID::compute(void)
      ((_mode == AUTO) && (millis() - _lastTime < _pidPeriod)))
     return(false);
 
+  if (getTuneState() == TUNE_RUN)
+  {
+    tuneStep();
+    _lastTime = millis();
+    return(true);
+  }
+
   // Compute all the working error variables
   int16_t dCv = *_cv - _prevCv;
+  int32_t co;     // output before limits (fixed point)
 
   _error = *_sp - *_cv;
 
-  // Working error, proportional distribution and PID output
+  // Low pass filter the change in current value, kept in Q4 fixed point
+  if (_dAlpha >= 256)
+    _dCvF = (int32_t)dCv << 4;
+  else
+    _dCvF += ((int32_t)_dAlpha * (((int32_t)dCv << 4) - _dCvF)) >> 8;
+
+  // Working error, proportional distribution and PID output.
+  // The output is accumulated in fixed point so that the small increments
+  // from short PID periods are not lost to truncation.
+#if PID_FIXED_POINT
+  {
+    // Each term is an int16_t * int16_t product, so can't overflow.
+    // The value fraction bits are taken off the products.
+    int16_t dCvF = constrain(_dCvF >> _vBits, INT16_MIN, INT16_MAX);
+
+    co = addSat(((int32_t)_kpiFx * _error) >> _vBits, -(((int32_t)_kpdFx * dCvF) >> 4));
+    co = addSat(_prevCo, co);
+  }
+#else
   if (_kpi < 31 && _kpd < 31) 
-    _prevCo += FX_MUL(FL_FX(_kpi), _error) - FX_MUL(FL_FX(_kpd), dCv);
+    co = _prevCo + ((FL_FX(_kpi) * _error) >> _vBits) - ((FL_FX(_kpd) * _dCvF) >> (4 + _vBits));
   else 
-    _prevCo += (_kpi * _error) - (_kpd * dCv);
+    co = _prevCo + FL_FX(((_kpi * _error) - ((_kpd * _dCvF) / 16.0)) / (1 << _vBits));
+#endif
 
-  *_co = clampOutput(_prevCo);
+  // Add any change in the feed-forward output
+  {
+    int32_t ff = feedForward();
+
+    co = addSat(co, ff - _prevFf);
+    _prevFf = ff;
+  }
+
+  // Limit the output range and rate of change. The accumulator then 
+  // tracks the output actually used (back-calculation anti-windup with a 
+  // tracking time of one PID period), so it can't wind up past it.
+  {
+    int32_t u = clampAccum(co);
+
+    if (_outRate != 0)
+    {
+      int32_t du = INT_FX(_outRate);
+
+      if (u > _prevCo + du) u = _prevCo + du;
+      else if (u < _prevCo - du) u = _prevCo - du;
+    }
+    _prevCo = u;
+  }
+  *_co = FX_INT(_prevCo);
 
   // Remember some variables for next time
   _prevCv = *_cv;
@@ -61,6 +112,10 @@ void SC_PID::setTuning(float Kp, float Ki, float Kd, float pOn)
   _kd = Kd / pidFrequency;
   _kpi = (_kp * _pOn) + _ki;
   _kpd = _kp * (1 - _pOn) + _kd;
+#if PID_FIXED_POINT
+  _kpiFx = FL_FX16(_kpi);
+  _kpdFx = FL_FX16(_kpd);
+#endif
 
   if (_controller == REVERSE)
   {
@@ -70,15 +125,63 @@ void SC_PID::setTuning(float Kp, float Ki, float Kd, float pOn)
   }
 }
 
+void SC_PID::setFeedForward(float Ks, float Kv)
+// A change takes effect at the next compute(), as the change 
+// from the last feed-forward output is added to the output.
+{
+  _ks = Ks;
+  _kv = Kv;
+#if PID_FIXED_POINT
+  _ksFx = FL_FX(Ks);
+  _kvFx = FL_FX16(Kv);
+#endif
+}
+
+inline int32_t SC_PID::feedForward(void)
+{
+#if PID_FIXED_POINT
+  return(_ksFx + (((int32_t)_kvFx * *_sp) >> _vBits));
+#else
+  if (_ks == 0.0 && _kv == 0.0)
+    return(0);
+
+  return(FL_FX(_ks + ((_kv * *_sp) / (1 << _vBits))));
+#endif
+}
+
+void SC_PID::setDerivativeFilter(float tf)
+// The filter coefficient is T / (Tf + T) for the PID period T
+{
+  float t = (float)_pidPeriod / 1000.0;
+
+  if (tf < 0.0)
+    return;
+
+  _tf = tf;
+  _dAlpha = (256.0 * t / (tf + t)) + 0.5;
+  if (_dAlpha == 0) _dAlpha = 1;
+}
+
+void SC_PID::setValueScale(uint8_t bits)
+// The accumulated output is kept, so this can change while running.
+// The change in current value is filtered in the value units, so 
+// start the filter again.
+{
+  if (bits > 8 || bits == _vBits)
+    return;
+
+  _vBits = bits;
+  _dCvF = 0;
+  _prevFf = feedForward();
+}
+
 void SC_PID::setPIDPeriod(uint32_t newPeriod)
 {
   if (newPeriod == 0) return;
 
-  float ratio  = (float)newPeriod / (float)_pidPeriod;
-  _ki *= ratio;
-  _kd /= ratio;
-
   _pidPeriod = newPeriod;
+  setTuning(_userKp, _userKi, _userKd, _pOn);   // rescale all the dependent gains
+  setDerivativeFilter(_tf);
 }
 
 void SC_PID::setOutputLimits(int16_t min, int16_t max)
@@ -94,7 +197,7 @@ void SC_PID::setOutputLimits(int16_t min, int16_t max)
   if (_mode != OFF)
   {
     *_co = clampOutput(*_co);
-    _prevCo = clampOutput(_prevCo);
+    _prevCo = clampAccum(_prevCo);
   }
 }
 
@@ -108,12 +211,35 @@ void SC_PID::setMode(mode_t newMode)
 
 void SC_PID::reset(void)
 {
+  stopTune();
   _prevCv = *_cv;
-  _prevCo = clampOutput(*_co);
+  _prevCo = INT_FX(clampOutput(*_co));
+  _prevFf = 0;     // feed-forward is all added at the next step
+  _dCvF = 0;
   _lastTime = millis();
   _error = 0;
 }
 
+#if PID_FIXED_POINT
+int16_t SC_PID::FL_FX16(float a)
+{
+  float v = a * (float)(1L << PID_FX_BITS);
+
+  if (v >= INT16_MAX) return(INT16_MAX);
+  if (v <= INT16_MIN) return(INT16_MIN);
+
+  return(v < 0.0 ? v - 0.5 : v + 0.5);
+}
+#endif
+
+inline int32_t SC_PID::addSat(int32_t a, int32_t b)
+{
+  if (b > 0 && a > INT32_MAX - b) return(INT32_MAX);
+  if (b < 0 && a < INT32_MIN - b) return(INT32_MIN);
+
+  return(a + b);
+}
+
 inline int16_t SC_PID::clampOutput(int16_t value)
 {
   if (value > _outMax)
@@ -124,6 +250,16 @@ inline int16_t SC_PID::clampOutput(int16_t value)
   return(value);
 }
 
+inline int32_t SC_PID::clampAccum(int32_t value)
+{
+  if (value > INT_FX(_outMax))
+    return(INT_FX(_outMax));
+  else if (value < INT_FX(_outMin))
+    return(INT_FX(_outMin));
+
+  return(value);
+}
+
 void SC_PID::setControlType(control_t cType)
 {
   if (cType != _controller)
@@ -134,3 +270,118 @@ void SC_PID::setControlType(control_t cType)
   }
   _controller = cType;
 }
+
+bool SC_PID::startTune(int16_t step, int16_t noise, uint8_t cycles)
+{
+  if (_tune == nullptr)
+    _tune = new tuneData_t;
+  if (_tune == nullptr)
+    return(false);
+
+  _tune->state = TUNE_RUN;
+  _tune->bias = clampOutput(*_co);
+  _tune->step = abs(step);
+  _tune->noise = abs(noise);
+  _tune->cycles = (cycles == 0 ? 1 : cycles);
+  _tune->cycle = 0;
+  _tune->steps = 0;
+  _tune->high = (_controller == DIRECT) ? (*_sp > *_cv) : (*_sp < *_cv);
+  _tune->cvMax = _tune->cvMin = *_cv;
+  _tune->sumSteps = _tune->sumAmp = 0;
+
+  return(true);
+}
+
+void SC_PID::stopTune(void)
+{
+  delete _tune;
+  _tune = nullptr;
+}
+
+void SC_PID::tuneStep(void)
+// Relay output with a noise band. Each cycle starts when the output 
+// switches high. The first cycle is ignored while the oscillation 
+// builds up, then the period and peak to peak value are totaled for 
+// the measured cycles.
+{
+  const uint16_t TUNE_STEPS_MAX = 100;  // no switch in this many steps is a failure
+
+  tuneData_t& t = *_tune;
+  int16_t e = *_sp - *_cv;
+
+  if (_controller == REVERSE) e = -e;
+
+  t.steps++;
+  if (*_cv > t.cvMax) t.cvMax = *_cv;
+  if (*_cv < t.cvMin) t.cvMin = *_cv;
+
+  if (!t.high && e > t.noise)
+  {
+    t.high = true;
+    if (t.cycle > 1)
+    {
+      t.sumSteps += t.steps;
+      t.sumAmp += t.cvMax - t.cvMin;
+    }
+    if (t.cycle > t.cycles)
+    {
+      // Measured all the cycles, work out the results
+      float a = (float)t.sumAmp / (2.0 * t.cycles);
+
+      if (a > t.noise)
+      {
+        t.ku = (4.0 * t.step * (1 << _vBits)) / (PI * sqrt((a * a) - ((float)t.noise * t.noise)));
+        t.pu = (t.sumSteps * _pidPeriod) / t.cycles;
+        t.state = TUNE_DONE;
+      }
+      else
+        t.state = TUNE_FAILED;
+    }
+    t.cycle++;
+    t.steps = 0;
+    t.cvMax = t.cvMin = *_cv;
+  }
+  else if (t.high && e < -t.noise)
+    t.high = false;
+  else if (t.steps > TUNE_STEPS_MAX)
+    t.state = TUNE_FAILED;
+
+  if (t.state == TUNE_RUN)
+    *_co = clampOutput(t.high ? t.bias + t.step : t.bias - t.step);
+  else
+  {
+    // finished, so carry on with the PID calculation from the bias
+    *_co = t.bias;
+    _prevCo = INT_FX(t.bias);
+    _prevFf = feedForward();
+  }
+  _prevCv = *_cv;
+  _error = e;
+}
+
+bool SC_PID::getTuneResult(tuneRule_t rule, float& Kp, float& Ki, float& Kd)
+{
+  float kc, ti;
+  float t = (float)_pidPeriod / 1000.0;
+
+  if (getTuneState() != TUNE_DONE)
+    return(false);
+
+  // Proportional gain and integral time (s) for the rule.
+  // Derivative time is not used (see pagePID).
+  switch (rule)
+  {
+  case ZIEGLER_NICHOLS_PI:  kc = 0.45 * _tune->ku; ti = _tune->pu / 1200.0; break;
+  case ZIEGLER_NICHOLS_PID: kc = 0.6 * _tune->ku;  ti = _tune->pu / 2000.0; break;
+  case TYREUS_LUYBEN:       kc = _tune->ku / 3.2;  ti = _tune->pu * 0.0022; break;
+  case SOME_OVERSHOOT:      kc = 0.33 * _tune->ku; ti = _tune->pu / 2000.0; break;
+  case NO_OVERSHOOT:        kc = 0.2 * _tune->ku;  ti = _tune->pu / 2000.0; break;
+  default: return(false);
+  }
+
+  Kp = (kc * t) / ti;
+  Ki = 0.0;
+  Kd = kc * t;
+
+  return(true);
+}
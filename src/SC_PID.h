@@ -18,10 +18,109 @@
 
  Ideas also taken from a detailed explanation PID coding at
  http://brettbeauregard.com/blog/2011/04/improving-the-beginners-pid-introduction/
+
+ ### Feed-forward
+ A PID controller only changes its output in response to an error, so every 
+ change in the set point has to be 'discovered' by the controller before it 
+ responds. If there is a model of the output needed for a given set point, 
+ the controller can add this directly (feed-forward) and the PID only needs 
+ to correct the residual error.
+
+ The feed-forward model is a straight line
+ \code output = Ks + Kv * setpoint \endcode
+ where Ks is the output needed to overcome friction and Kv is the slope of 
+ the output against the set point. For a DC motor these are found by running 
+ the motor at 2 different PWM settings and measuring the speed at each.
+
+ The controller calculates its output incrementally, so the change in the 
+ feed-forward value since the last step is added to the output together with 
+ the PID correction. Setting both coefficients to 0 (the default) turns off 
+ the feed-forward. The output at reset() is taken to be the PID part only, so 
+ the whole feed-forward value is added at the first step after a reset.
+
+ ### Autotuning
+ The controller can find its own tuning using the Astrom-Hagglund relay method. 
+ Once started by startTune(), each compute() step sets the output to a fixed 
+ step above or below the output at the start (the bias), depending on whether 
+ the current value is below or above the set point. This makes the current 
+ value oscillate around the set point. The period of the oscillation is the 
+ ultimate period Pu and, from the size of the oscillation a and the output 
+ step d, the ultimate gain is
+ \code Ku = 4d / (pi * sqrt(a^2 - n^2)) \endcode
+ where n is the noise band - the error has to be larger than this before the 
+ output is switched, so that measurement noise does not cause extra switching.
+
+ The first cycle is ignored, as the oscillation is still building up, and Ku and 
+ Pu are the average of the next few cycles. The tuning runs in the normal 
+ compute() cadence, so nothing else needs to wait. Once it is finished the PID 
+ calculation continues from the bias output with the existing coefficients.
+
+ getTuneResult() works out the coefficients from Ku and Pu using one of the 
+ standard rules (tuneRule_t). The rules give a proportional gain Kc, integral 
+ time Ti and derivative time Td. This controller calculates its output 
+ incrementally with proportional on error (the default pOn = 1), so the change 
+ in output is Kp * error - Kd * (change in current value) at each step. Kp 
+ therefore works as the integral gain and Kd as the proportional gain, and the 
+ coefficients returned are Kp = Kc * T / Ti, Ki = 0 and Kd = Kc * T for the PID 
+ period T in seconds. There is no place for the derivative time in this form, 
+ so Td is not used.
+
+ ### Output Conditioning
+ The change in the current value is taken straight from the measurements, 
+ so any measurement noise (eg, encoder quantization) goes through Kd into the 
+ output and, for a motor, makes the PWM chatter. setDerivativeFilter() adds a 
+ first order low pass filter to the change in current value
+ \code dCvF = dCvF + (T / (Tf + T)) * (dCv - dCvF) \endcode
+ for the PID period T and filter time constant Tf. A larger Tf is smoother 
+ but slows the response to real changes, so Tf is usually kept to a few PID 
+ periods or less.
+
+ setOutputRate() limits how much the output can change at each step. This 
+ stops large steps in the output, such as from a set point change, but also 
+ slows the response to them.
+
+ The output is limited to the output limits and the slew rate and the 
+ accumulated output is then set back to the limited value (back-calculation 
+ anti-windup with a tracking time of one PID period). The integral action 
+ never 'winds up' past the output that is actually applied, so the controller 
+ comes off a limit as soon as the error changes sign.
+
+ ### Fixed Point
+ The output is always accumulated in fixed point, with PID_FX_BITS fraction 
+ bits, so that the small changes from short PID periods are not lost to 
+ truncation.
+
+ When PID_FIXED_POINT is set (the default for AVR) the compute() calculation 
+ is all integer arithmetic. The coefficients are converted to fixed point 
+ with the same fraction bits by setTuning(), setFeedForward() and 
+ setPIDPeriod(), and are limited to the int16_t range, so with the default 
+ 8 fraction bits each working coefficient must be less than 128. Each term is 
+ an int16_t by int16_t product, and the terms are added with saturation, so 
+ the 32 bit accumulator can't overflow. More fraction bits give finer 
+ coefficients (useful for short PID periods) but a smaller coefficient range.
+
+ Otherwise the calculation is in floating point if the coefficients are too 
+ large for the fixed point calculation.
+
+ The set point and current value can also be fixed point (setValueScale()).
+ The products with the coefficients are then shifted down by the value 
+ fraction bits, so the coefficients are always per whole unit. MD_SmartCar 
+ uses this to control the motor speeds in 1/16ths of a pulse per second.
  */
 
 #include <Arduino.h>
 
+#ifndef PID_FIXED_POINT
+#ifdef __AVR__
+#define PID_FIXED_POINT 1 ///< set to 1 for integer only compute() (default for AVR)
+#else
+#define PID_FIXED_POINT 0 ///< set to 1 for integer only compute() (default for AVR)
+#endif
+#endif
+#ifndef PID_FX_BITS
+#define PID_FX_BITS 8     ///< fraction bits for the fixed point output and coefficients [4..12]
+#endif
+
 /**
  * Core object for the SC_PID class
  * Implements PID control algorithm DC motor control, as a hybrid fixed-point and 
@@ -52,6 +151,29 @@ public:
     DIRECT, ///< An increase in the control output increases the controlled variable.
     REVERSE ///< An increase in the control output decreases the controlled variable. 
   } control_t;
+
+  /**
+   * Autotune progress
+   */
+  typedef enum
+  {
+    TUNE_OFF,     ///< No autotune has been run.
+    TUNE_RUN,     ///< The relay oscillation is being measured.
+    TUNE_DONE,    ///< Ku and Pu have been measured.
+    TUNE_FAILED,  ///< There was no usable oscillation.
+  } tuneState_t;
+
+  /**
+   * Rules for working out the PID coefficients from an autotune
+   */
+  typedef enum
+  {
+    ZIEGLER_NICHOLS_PI,  ///< Ziegler-Nichols PI - Kc = 0.45Ku, Ti = Pu/1.2
+    ZIEGLER_NICHOLS_PID, ///< Ziegler-Nichols PID - Kc = 0.6Ku, Ti = Pu/2, Td = Pu/8
+    TYREUS_LUYBEN,       ///< Tyreus-Luyben PI, slower and more robust - Kc = Ku/3.2, Ti = 2.2Pu
+    SOME_OVERSHOOT,      ///< PID with some overshoot - Kc = 0.33Ku, Ti = Pu/2, Td = Pu/3
+    NO_OVERSHOOT,        ///< PID with no overshoot - Kc = 0.2Ku, Ti = Pu/2, Td = Pu/3
+  } tuneRule_t;
   /** @} */
 
  //--------------------------------------------------------------
@@ -84,7 +206,7 @@ public:
    *
    * Release any allocated memory and clean up anything else.
    */
-  ~SC_PID(void) {}
+  ~SC_PID(void) { delete _tune; }
   /** @} */
 
   //--------------------------------------------------------------
@@ -119,7 +241,8 @@ public:
    * Reset the PID calculation.
    *
    * Reset the PID calculation. The library will ensure a bumpless 
-   * transition between current and reset state.
+   * transition between current and reset state. Any autotune in 
+   * progress is stopped.
    * 
    * Not generally required but available.
    */
@@ -128,9 +251,10 @@ public:
   /**
    * Reset the PID calculation period.
    *
-   * Reset the PID calculation period. Really only applies in AUTO mode.
-   * 
-   * Not generally required but available.
+   * Reset the PID calculation period. In AUTO mode this is the interval 
+   * between calculations. In USER mode it is the interval assumed between 
+   * calls to compute(). The Ki and Kd coefficients are rescaled for the 
+   * new period.
    * 
    * \sa setMode()
    * 
@@ -206,6 +330,142 @@ public:
    * \param Kd The new Derivative coefficient.
    */
   void setTuning(float Kp, float Ki, float Kd) { setTuning(Kp, Ki, Kd, _pOn); };
+
+  /**
+   * Set the feed-forward coefficients.
+   *
+   * The feed-forward output (Ks + Kv * setpoint) is added to the PID output
+   * so that the PID only needs to correct the error from this model. The
+   * units are the output units for Ks and output units per setpoint unit 
+   * for Kv.
+   *
+   * Setting both coefficients to 0 turns off feed-forward.
+   *
+   * \param Ks The static (friction) offset.
+   * \param Kv The output per unit of setpoint.
+   */
+  void setFeedForward(float Ks, float Kv);
+
+  /**
+   * Set the derivative filter time constant.
+   *
+   * The change in current value used for the derivative (proportional on 
+   * measurement) part of the output is passed through a first order low 
+   * pass filter with this time constant. The filter smooths measurement 
+   * noise at the cost of a slower response.
+   *
+   * \sa \ref pagePID
+   *
+   * \param tf The filter time constant in seconds. 0 for no filtering.
+   */
+  void setDerivativeFilter(float tf);
+
+  /**
+   * Set the output rate limit.
+   *
+   * Limit the change in the control output at each PID step.
+   *
+   * \sa \ref pagePID
+   *
+   * \param maxStep The largest change in output at one step. 0 for no limit.
+   */
+  void setOutputRate(uint16_t maxStep) { _outRate = maxStep; }
+
+  /**
+   * Set the set point and current value scale.
+   *
+   * The set point and current value can be fixed point numbers, with
+   * bits fraction bits, so that values between whole units can be 
+   * controlled. The coefficients (including feed-forward) stay in output 
+   * units per whole unit of the set point, so changing the scale does not
+   * change the tuning. The default is 0 (integer values).
+   *
+   * The autotune noise band is in the scaled units, but the gain it 
+   * measures is per whole unit.
+   *
+   * \sa \ref pagePID
+   *
+   * \param bits the number of fraction bits [0..8].
+   */
+  void setValueScale(uint8_t bits);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for autotuning.
+   * @{
+   */
+  /**
+   * Start an autotune.
+   *
+   * Start the relay autotune from the current output, which should hold 
+   * the current value close to the set point. From the next compute() the 
+   * output switches between (bias + step) and (bias - step), clamped to 
+   * the output limits, until the oscillation has been measured.
+   * 
+   * The controller mode needs to be AUTO or USER so that compute() runs.
+   *
+   * \sa getTuneState(), getTuneResult(), stopTune(), \ref pagePID
+   *
+   * \param step   the change in output either side of the bias.
+   * \param noise  the error needed to switch the output (noise band).
+   * \param cycles the number of oscillation cycles to measure.
+   * \return false if the autotune could not be started (no memory).
+   */
+  bool startTune(int16_t step, int16_t noise = 0, uint8_t cycles = 4);
+
+  /**
+   * Stop an autotune.
+   *
+   * Stop the autotune and release the memory used. The result is lost and 
+   * the PID calculation continues from the current output.
+   *
+   * \sa startTune()
+   */
+  void stopTune(void);
+
+  /**
+   * Get the autotune progress.
+   *
+   * \sa startTune()
+   *
+   * \return the current tuneState_t.
+   */
+  tuneState_t getTuneState(void) { return(_tune == nullptr ? TUNE_OFF : _tune->state); }
+
+  /**
+   * Get the autotune ultimate gain.
+   *
+   * \sa getTuneResult()
+   *
+   * \return the measured ultimate gain Ku (output units per whole current value unit), 0 if not measured.
+   */
+  float getKu(void) { return(getTuneState() == TUNE_DONE ? _tune->ku : 0.0); }
+
+  /**
+   * Get the autotune ultimate period.
+   *
+   * \sa getTuneResult()
+   *
+   * \return the measured ultimate period Pu in milliseconds, 0 if not measured.
+   */
+  uint32_t getPu(void) { return(getTuneState() == TUNE_DONE ? _tune->pu : 0); }
+
+  /**
+   * Get the autotune coefficients.
+   *
+   * Work out the PID coefficients from the measured ultimate gain and period 
+   * using the specified rule. The coefficients are ready for setTuning(), 
+   * but are not applied.
+   *
+   * \sa startTune(), setTuning(), \ref pagePID
+   *
+   * \param rule the tuning rule to use (one of tuneRule_t).
+   * \param Kp the proposed Proportional coefficient.
+   * \param Ki the proposed Integral coefficient.
+   * \param Kd the proposed Derivative coefficient.
+   * \return true if the autotune is done and the coefficients were set.
+   */
+  bool getTuneResult(tuneRule_t rule, float& Kp, float& Ki, float& Kd);
   /** @} */
 
  //--------------------------------------------------------------
@@ -253,6 +513,41 @@ public:
    */
   inline float getKd(void) { return(_userKd); }
 
+  /**
+   * Return the current feed-forward Ks value.
+   *
+   * \return The feed-forward static offset.
+   */
+  inline float getKs(void) { return(_ks); }
+
+  /**
+   * Return the current feed-forward Kv value.
+   *
+   * \return The feed-forward output per unit of setpoint.
+   */
+  inline float getKv(void) { return(_kv); }
+
+  /**
+   * Return the current derivative filter time constant.
+   *
+   * \return The filter time constant in seconds, 0 if no filtering.
+   */
+  inline float getDerivativeFilter(void) { return(_tf); }
+
+  /**
+   * Return the current output rate limit.
+   *
+   * \return The largest change in output at one step, 0 if no limit.
+   */
+  inline uint16_t getOutputRate(void) { return(_outRate); }
+
+  /**
+   * Return the current set point and current value scale.
+   *
+   * \return The number of fraction bits in the set point and current value.
+   */
+  inline uint8_t getValueScale(void) { return(_vBits); }
+
   /**
    * Return the current PID calculation period.
    *
@@ -281,6 +576,17 @@ private:
   float _pOn;             ///< Proportional on Error/Measurement combination factor (0.0 .. 1.0). Default = 1.0, 100% PoE/0% PoM
   float _kpi;             ///< Proportional on error amount
   float _kpd;             ///< Proportional on measurement amount
+#if PID_FIXED_POINT
+  int16_t _kpiFx;         ///< Proportional on error amount (fixed point)
+  int16_t _kpdFx;         ///< Proportional on measurement amount (fixed point)
+  int32_t _ksFx;          ///< Feed-forward static offset (fixed point)
+  int16_t _kvFx;          ///< Feed-forward slope (fixed point)
+#endif
+  float _ks, _kv;         ///< Feed-forward static offset and slope
+  float _tf;              ///< Derivative filter time constant in seconds
+  uint16_t _dAlpha;       ///< Derivative filter coefficient (fixed point, 256 = no filtering)
+  uint16_t _outRate;      ///< Largest change in output at each step (0 = no limit)
+  uint8_t _vBits;         ///< Fraction bits in the setpoint and current value
 
   control_t _controller;  ///< type of controller being (DIRECT, REVERSE)
   mode_t  _mode;          ///< current controller mode (OFF, AUTO, USER)
@@ -294,10 +600,40 @@ private:
   int16_t _outMin, _outMax; ///< Control output min and max values 
   int16_t _error;           ///< PID error accumulator
   int16_t _prevCv;          ///< PID previous current value (for PoM calcs)
-  int16_t _prevCo;          ///< Control output calculated at the last iteration
+  int32_t _prevCo;          ///< Control output calculated at the last iteration (fixed point)
+  int32_t _prevFf;          ///< Feed-forward output at the last iteration (fixed point)
+  int32_t _dCvF;            ///< Filtered change in current value (Q4 fixed point)
+
+  // Autotune working data, only allocated while it is needed
+  struct tuneData_t
+  {
+    tuneState_t state;  ///< autotune progress
+    int16_t bias;       ///< output at the start of the autotune
+    int16_t step;       ///< output change either side of the bias
+    int16_t noise;      ///< error needed to switch the output
+    bool high;          ///< output is currently above the bias
+    uint8_t cycles;     ///< number of cycles to measure
+    uint8_t cycle;      ///< cycles started so far
+    uint16_t steps;     ///< compute() steps in this cycle
+    int16_t cvMax;      ///< highest current value in this cycle
+    int16_t cvMin;      ///< lowest current value in this cycle
+    uint32_t sumSteps;  ///< total steps in the measured cycles
+    uint32_t sumAmp;    ///< total peak to peak current value in the measured cycles
+    float ku;           ///< ultimate gain
+    uint32_t pu;        ///< ultimate period in ms
+  };
+  tuneData_t* _tune;        ///< autotune data, nullptr if none
 
   int16_t clampOutput(int16_t value);   ///< clamp the output to be in the range [_outMin, _outMax]
+  int32_t clampAccum(int32_t value);    ///< clamp the fixed point output to be in the range [_outMin, _outMax]
+  int32_t feedForward(void);            ///< feed-forward output for the current setpoint (fixed point)
+  void tuneStep(void);                  ///< run one relay autotune step
 
-  inline int32_t FL_FX(float a) { return(a * 256.0);}                   ///< float to fixed point
-  inline int32_t FX_MUL(int32_t a, int32_t b) { return((a * b) >> 8); } ///< fixed point multiply
+  inline int32_t FL_FX(float a) { return(a * (float)(1L << PID_FX_BITS)); }         ///< float to fixed point
+  inline int32_t INT_FX(int16_t a) { return((int32_t)a << PID_FX_BITS); }            ///< integer to fixed point
+  inline int16_t FX_INT(int32_t a) { return((a + (1L << (PID_FX_BITS - 1))) >> PID_FX_BITS); } ///< fixed point to rounded integer
+  int32_t addSat(int32_t a, int32_t b);   ///< add with saturation at the int32_t limits
+#if PID_FIXED_POINT
+  int16_t FL_FX16(float a);               ///< float to rounded fixed point, saturated to int16_t
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,222 @@
+/**
+ * \file
+ * \brief Class definition file for the SC_Telemetry class.
+ */
+
+#include <MD_SmartCar.h>   // PID_TUNE and SCDEBUG set the SC_Telemetry buffer size
+
+static const uint8_t BUF_MASK = TELEMETRY_BUF_SIZE - 1;
+
+static inline uint32_t irqSave(void)
+// Turn interrupts off and return the previous state for irqRestore().
+// The state is saved where the core allows it, so interrupts are not
+// turned back on early when this is called from an interrupt.
+{
+#if defined(__AVR__)
+  uint8_t s = SREG;
+
+  cli();
+  return(s);
+#elif defined(__arm__)
+  uint32_t s = __get_PRIMASK();
+
+  __disable_irq();
+  return(s);
+#else
+  noInterrupts();
+  return(0);
+#endif
+}
+
+static inline void irqRestore(uint32_t s)
+{
+#if defined(__AVR__)
+  SREG = (uint8_t)s;
+#elif defined(__arm__)
+  if (s == 0) __enable_irq();
+#else
+  (void)s;
+  interrupts();
+#endif
+}
+
+uint16_t SC_Telemetry::crc16(const uint8_t* p, uint8_t len)
+// Byte at a time CRC-16/CCITT (0x1021 polynomial), short enough to run
+// with interrupts off.
+{
+  uint16_t crc = 0xffff;
+
+  while (len--)
+  {
+    crc = (crc >> 8) | (crc << 8);
+    crc ^= *p++;
+    crc ^= (crc & 0xff) >> 4;
+    crc ^= crc << 12;
+    crc ^= (crc & 0xff) << 5;
+  }
+
+  return(crc);
+}
+
+bool SC_Telemetry::put(uint8_t* f, uint8_t len)
+// Number the frame, add the CRC and copy it into the ring buffer. Frames
+// can come from both run() and the tick() interrupt, so interrupts are off
+// while this is done. _head is only updated once the whole frame is in
+// place, so drain() never sees a partial frame.
+{
+  bool b = false;
+  uint16_t crc;
+  uint32_t irq = irqSave();
+
+  f[0] = SYNC;
+  f[2] = _seq++;
+  crc = crc16(&f[2], len - 4);
+  f[len - 2] = crc & 0xff;
+  f[len - 1] = crc >> 8;
+
+  if ((uint8_t)(BUF_MASK - ((_head - _tail) & BUF_MASK)) < len)
+    _dropped++;
+  else
+  {
+    uint8_t head = _head;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+      _buf[head] = f[i];
+      head = (head + 1) & BUF_MASK;
+    }
+    _head = head;
+    b = true;
+  }
+  irqRestore(irq);
+
+  return(b);
+}
+
+bool SC_Telemetry::write(const record_t& r)
+{
+  uint8_t f[FRAME_SIZE];
+  uint8_t n = 3;
+
+  f[1] = FRAME_PID;
+  for (uint8_t i = 0; i < 4; i++)
+    f[n++] = (r.time >> (8 * i)) & 0xff;
+  for (uint8_t i = 0; i < MAX_CHANNEL; i++)
+  {
+    f[n++] = r.sp[i] & 0xff;  f[n++] = (uint16_t)r.sp[i] >> 8;
+    f[n++] = r.cv[i] & 0xff;  f[n++] = (uint16_t)r.cv[i] >> 8;
+    f[n++] = r.co[i] & 0xff;  f[n++] = (uint16_t)r.co[i] >> 8;
+  }
+
+  return(put(f, FRAME_SIZE));
+}
+
+void SC_Telemetry::log(uint16_t id)
+{
+  uint8_t f[LOG_SIZE];
+
+  f[1] = FRAME_LOG;
+  f[3] = LOG_STR;
+  f[4] = id & 0xff;
+  f[5] = id >> 8;
+  put(f, LOG_SIZE);
+}
+
+void SC_Telemetry::log(uint16_t id, double v)
+{
+  float fv = v;
+  uint32_t u;
+
+  memcpy(&u, &fv, sizeof(u));
+  logValue(LOG_FLOAT, id, u);
+}
+
+void SC_Telemetry::logValue(logType_t type, uint16_t id, uint32_t v)
+{
+  uint8_t f[LOG_VALUE_SIZE];
+
+  f[1] = FRAME_LOG;
+  f[3] = type;
+  f[4] = id & 0xff;
+  f[5] = id >> 8;
+  for (uint8_t i = 0; i < 4; i++)
+    f[6 + i] = (v >> (8 * i)) & 0xff;
+  put(f, LOG_VALUE_SIZE);
+}
+
+void SC_Telemetry::drain(void)
+{
+  uint8_t tail = _tail;
+  int space = Serial.availableForWrite();
+
+  while (tail != _head && space-- > 0)
+  {
+    Serial.write(_buf[tail]);
+    tail = (tail + 1) & BUF_MASK;
+  }
+  _tail = tail;
+}
+
+uint8_t SC_Telemetry::frameSize(const uint8_t* frame)
+{
+  if (frame[0] != SYNC)
+    return(0);
+  if (frame[1] == FRAME_PID)
+    return(FRAME_SIZE);
+  if (frame[1] == FRAME_LOG)
+  {
+    switch (frame[3])
+    {
+    case LOG_STR: return(LOG_SIZE);
+    case LOG_INT:
+    case LOG_UINT:
+    case LOG_HEX:
+    case LOG_FLOAT: return(LOG_VALUE_SIZE);
+    }
+  }
+
+  return(0);
+}
+
+bool SC_Telemetry::decode(const uint8_t* frame, record_t& r)
+{
+  uint8_t n = 2;
+
+  if (frame[0] != SYNC || frame[1] != FRAME_PID)
+    return(false);
+  if (crc16(&frame[2], FRAME_SIZE - 4) != (frame[FRAME_SIZE - 2] | ((uint16_t)frame[FRAME_SIZE - 1] << 8)))
+    return(false);
+
+  r.seq = frame[n++];
+  r.time = 0;
+  for (uint8_t i = 0; i < 4; i++)
+    r.time |= (uint32_t)frame[n++] << (8 * i);
+  for (uint8_t i = 0; i < MAX_CHANNEL; i++)
+  {
+    r.sp[i] = (int16_t)(frame[n] | ((uint16_t)frame[n + 1] << 8));  n += 2;
+    r.cv[i] = (int16_t)(frame[n] | ((uint16_t)frame[n + 1] << 8));  n += 2;
+    r.co[i] = (int16_t)(frame[n] | ((uint16_t)frame[n + 1] << 8));  n += 2;
+  }
+
+  return(true);
+}
+
+bool SC_Telemetry::decodeLog(const uint8_t* frame, uint8_t& seq, logType_t& type, uint16_t& id, uint32_t& v)
+{
+  uint8_t len = frameSize(frame);
+
+  if (len == 0 || frame[1] != FRAME_LOG)
+    return(false);
+  if (crc16(&frame[2], len - 4) != (frame[len - 2] | ((uint16_t)frame[len - 1] << 8)))
+    return(false);
+
+  seq = frame[2];
+  type = (logType_t)frame[3];
+  id = frame[4] | ((uint16_t)frame[5] << 8);
+  v = 0;
+  if (len == LOG_VALUE_SIZE)
+    for (uint8_t i = 0; i < 4; i++)
+      v |= (uint32_t)frame[6 + i] << (8 * i);
+
+  return(true);
+}
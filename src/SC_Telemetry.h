@@ -0,0 +1,316 @@
+#pragma once
+/**
+ * \file
+ * \brief Header file for the SC_Telemetry class of the MD_SmartCar library.
+ */
+
+/**
+ \page pageTelemetry Telemetry and Debug Log
+
+ ## SmartCar Telemetry and Debug Log
+
+ When PID_TUNE is turned on the library sends the PID set point (SP),
+ current value (CV) and control output (CO) of each motor every PID period.
+ When SCDEBUG is turned on the SCPRINT macros log what the library is doing.
+ Formatting either of these as text and printing it takes several milliseconds 
+ at typical baud rates and would hold up run() (or the timer interrupt running
+ tick()) while it happens, changing the timing of the very code being tuned
+ or debugged.
+
+ Instead both are sent as small binary frames through a ring buffer, the
+ global SCTelemetry object. Adding a frame only copies a few bytes and is safe 
+ to do from an interrupt. MD_SmartCar::run() then sends the buffered bytes to 
+ Serial, but only as many as will fit in the Serial transmit buffer without 
+ waiting. If the serial link cannot keep up the newest frames are dropped rather 
+ than blocking, and the sequence number in each frame shows where this has 
+ happened. The buffer is TELEMETRY_BUF_SIZE bytes and must hold everything 
+ logged between two calls to run(). The default is 128 bytes, enough for the 
+ 21 byte PID frame, or 256 bytes (the largest size) when SCDEBUG is on. A PID 
+ step logs 12 bytes plus 48 bytes for each motor, so 256 bytes holds one step 
+ for up to 4 motors with the PID frame as well. This costs 128 bytes more RAM
+ in debug builds. Moves log each wheel that moved every time run() is called, so 
+ a position controlled move with 4 motors, or a slow serial link that cannot 
+ keep up (more than 57600 baud is needed), will still drop some records. 
+ Nothing is sent until run() is called, so most of the debug output from 
+ MD_SmartCar::begin() will be dropped.
+
+ Debug log frames do not contain the text. Each SCPRINT string is replaced at 
+ compile time by a 16 bit hash of the string, and the value (if any) is sent
+ as a raw binary number. This makes the log frames short and takes the strings
+ out of the program memory. The text is put back by the host decoder, which 
+ works out the same hash for every SCPRINT string in the library source. Every
+ SCPRINT string must have a different hash, so the host build (make in 
+ extras/host) fails if two of them collide and one must be reworded.
+
+ ### Frame Format
+ All multi-byte values are little endian. Every frame starts with the same
+ 3 bytes and ends with a CRC-16/CCITT (polynomial 0x1021, initial 0xffff) of 
+ all the bytes after the first 2.
+
+ | Offset | Size | Content |
+ |--------|------|---------|
+ | 0      | 1    | sync byte 0xa5 |
+ | 1      | 1    | frame type, 0x5a for PID telemetry, 0x5b for a debug log record |
+ | 2      | 1    | sequence number, incremented for every frame (including dropped frames) |
+
+ PID telemetry (21 bytes)
+
+ | Offset | Size | Content |
+ |--------|------|---------|
+ | 3      | 4    | millis() time stamp |
+ | 7      | 6 per motor | SP, CV, CO for each motor (int16_t) |
+ | 19     | 2    | CRC |
+
+ Debug log record (8 or 12 bytes)
+
+ | Offset | Size | Content |
+ |--------|------|---------|
+ | 3      | 1    | value type, one of 'S' (no value), 'I' (signed), 'U' (unsigned), 'X' (hex) or 'F' (float) |
+ | 4      | 2    | hash of the SCPRINT string |
+ | 6      | 4    | value (not present for 'S') |
+ | 6 or 10 | 2   | CRC |
+
+ ### Decoding
+ The SmartCar_Telemetry program in the library _extras/host_ folder reads
+ the serial stream, checks the frames and writes them out as text. PID frames
+ are written in the format the library used to print 
+ ({SP_L,CV_L,CO_L,SP_R,CV_R,CO_R,millis}), which is what the _PID.json_ 
+ SerialStudio project expects, and debug log records as the SCPRINT string 
+ followed by the value. Anything else in the stream (eg, the Calibrate CLI text) 
+ is passed through unchanged.
+ \code
+ SmartCar_Telemetry /dev/ttyUSB0 57600
+ \endcode
+ reads from a serial port and
+ \code
+ SmartCar_Telemetry < capture.bin
+ \endcode
+ from a file or pipe. The SCPRINT strings are read from the library source
+ in ../../src (ie, run from the _extras/host_ folder) and any other folders
+ given with -s <folder>. Dropped and corrupted frames are reported on stderr.
+ */
+
+#include <Arduino.h>
+
+#ifndef TELEMETRY_BUF_SIZE
+#if SCDEBUG
+#define TELEMETRY_BUF_SIZE 256 ///< telemetry ring buffer size in bytes, must be a power of 2 up to 256
+#else
+#define TELEMETRY_BUF_SIZE 128 ///< telemetry ring buffer size in bytes, must be a power of 2 up to 256
+#endif
+#endif
+
+/**
+ * Core object for the SC_Telemetry class
+ * Buffers binary PID telemetry and debug log frames and sends them without blocking.
+ */
+class SC_Telemetry
+{
+public:
+  static const uint8_t MAX_CHANNEL = 2;       ///< number of motors in each PID frame
+  static const uint8_t SYNC = 0xa5;           ///< frame sync byte
+  static const uint8_t FRAME_PID = 0x5a;      ///< frame type for PID telemetry
+  static const uint8_t FRAME_LOG = 0x5b;      ///< frame type for debug log records
+  static const uint8_t FRAME_SIZE = 3 + 4 + (6 * MAX_CHANNEL) + 2;  ///< bytes in a PID frame
+  static const uint8_t LOG_SIZE = 3 + 3 + 2;  ///< bytes in a log frame with no value
+  static const uint8_t LOG_VALUE_SIZE = LOG_SIZE + 4; ///< bytes in a log frame with a value
+  static const uint8_t FRAME_MAX = FRAME_SIZE;  ///< the largest frame
+
+  /**
+   * Log record value type.
+   *
+   * How the value in a debug log record is printed.
+   */
+  enum logType_t
+  {
+    LOG_STR = 'S',    ///< just the string, no value
+    LOG_INT = 'I',    ///< signed integer
+    LOG_UINT = 'U',   ///< unsigned integer
+    LOG_HEX = 'X',    ///< unsigned integer in hexadecimal
+    LOG_FLOAT = 'F',  ///< floating point
+  };
+
+  /**
+   * Telemetry record.
+   *
+   * The information carried in each PID frame.
+   */
+  struct record_t
+  {
+    uint8_t seq;                ///< frame sequence number
+    uint32_t time;              ///< millis() time stamp
+    int16_t sp[MAX_CHANNEL];    ///< PID set point for each motor
+    int16_t cv[MAX_CHANNEL];    ///< PID current value for each motor
+    int16_t co[MAX_CHANNEL];    ///< PID control output for each motor
+  };
+
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class with an empty buffer.
+   */
+  SC_Telemetry(void) : _head(0), _tail(0), _seq(0), _dropped(0) {}
+
+  /**
+   * Class Destructor.
+   *
+   * Release any allocated memory and clean up anything else.
+   */
+  ~SC_Telemetry(void) {}
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+   * @{
+   */
+  /**
+   * Add a PID frame to the buffer.
+   *
+   * Encode the record into a frame and add it to the ring buffer. The
+   * sequence number in the record is ignored and set from the frame count.
+   * This is short and does not block, so it can be called from an
+   * interrupt routine. If there is no room in the buffer the frame is
+   * dropped.
+   *
+   * \param r the record to send.
+   * \return true if the frame was buffered, false if it was dropped.
+   */
+  bool write(const record_t& r);
+
+  /**
+   * Add a debug log frame to the buffer.
+   *
+   * Add a log record with no value. This is what SCPRINTS() uses. Like 
+   * write() this can be called from an interrupt routine and the frame
+   * is dropped if there is no room in the buffer.
+   *
+   * \param id the hash of the log string (see hash()).
+   */
+  void log(uint16_t id);
+
+  /**
+   * Add a debug log frame with a value to the buffer.
+   *
+   * Add a log record with a value. This is what SCPRINT() uses. There are
+   * versions for all the integer types and floating point.
+   *
+   * \param id the hash of the log string (see hash()).
+   * \param v  the value to log.
+   */
+  void log(uint16_t id, int v) { logValue(LOG_INT, id, (int32_t)v); }
+  void log(uint16_t id, unsigned int v) { logValue(LOG_UINT, id, (uint32_t)v); }  ///< \copydoc log(uint16_t, int)
+  void log(uint16_t id, long v) { logValue(LOG_INT, id, (int32_t)v); }            ///< \copydoc log(uint16_t, int)
+  void log(uint16_t id, unsigned long v) { logValue(LOG_UINT, id, (uint32_t)v); } ///< \copydoc log(uint16_t, int)
+  void log(uint16_t id, double v);                                                ///< \copydoc log(uint16_t, int)
+
+  /**
+   * Add a debug log frame with a hexadecimal value to the buffer.
+   *
+   * Add a log record with a value to be printed in hexadecimal. This is
+   * what SCPRINTX() uses.
+   *
+   * \param id the hash of the log string (see hash()).
+   * \param v  the value to log.
+   */
+  void logHex(uint16_t id, unsigned long v) { logValue(LOG_HEX, id, (uint32_t)v); }
+
+  /**
+   * Send buffered frames.
+   *
+   * Send as many buffered bytes to Serial as will fit in the Serial transmit
+   * buffer without waiting. Call this often from the main loop (it is called
+   * by MD_SmartCar::run()), not from an interrupt.
+   */
+  void drain(void);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Utility Functions.
+   * @{
+   */
+  /**
+   * Return the number of dropped frames.
+   *
+   * \return The number of frames dropped because the buffer was full.
+   */
+  inline uint16_t getDropped(void) { return(_dropped); }
+
+  /**
+   * Work out the hash of a log string.
+   *
+   * A 16 bit hash (32 bit FNV-1a folded in half) of the string. This is 
+   * evaluated by the compiler for the SCPRINT macros, so only the hash 
+   * ends up in the program. The host decoder uses the same calculation 
+   * to find the string for a log record.
+   *
+   * \param s the string.
+   * \return The hash of the string.
+   */
+  static constexpr uint16_t hash(const char* s) { return(fold(fnv(s, 2166136261UL))); }
+
+  /**
+   * Work out the size of a frame.
+   *
+   * Work out the size of a frame from its first 4 bytes. Used by the
+   * host decoder.
+   *
+   * \param frame pointer to at least 4 bytes of frame data.
+   * \return The size of the frame in bytes, 0 if it is not a valid frame.
+   */
+  static uint8_t frameSize(const uint8_t* frame);
+
+  /**
+   * Decode a PID frame.
+   *
+   * Check the sync bytes and CRC of a PID frame and unpack it into a record.
+   * Used by the host decoder.
+   *
+   * \param frame pointer to FRAME_SIZE bytes of frame data.
+   * \param r     the record to fill in.
+   * \return true if the frame was valid, false otherwise.
+   */
+  static bool decode(const uint8_t* frame, record_t& r);
+
+  /**
+   * Decode a debug log frame.
+   *
+   * Check the sync bytes and CRC of a log frame and unpack it.
+   * Used by the host decoder.
+   *
+   * \param frame pointer to the frame data.
+   * \param seq   the frame sequence number.
+   * \param type  the logType_t of the value.
+   * \param id    the hash of the log string.
+   * \param v     the value, 0 for LOG_STR. Floats are returned as their bit pattern.
+   * \return true if the frame was valid, false otherwise.
+   */
+  static bool decodeLog(const uint8_t* frame, uint8_t& seq, logType_t& type, uint16_t& id, uint32_t& v);
+
+  /**
+   * Calculate a CRC-16/CCITT.
+   *
+   * \param p   pointer to the data.
+   * \param len number of bytes of data.
+   * \return The CRC of the data.
+   */
+  static uint16_t crc16(const uint8_t* p, uint8_t len);
+  /** @} */
+
+private:
+  uint8_t _buf[TELEMETRY_BUF_SIZE];   ///< ring buffer
+  volatile uint8_t _head;             ///< next byte to write, only changed by put()
+  volatile uint8_t _tail;             ///< next byte to send, only changed by drain()
+  uint8_t _seq;                       ///< next frame sequence number
+  uint16_t _dropped;                  ///< frames dropped because the buffer was full
+
+  void logValue(logType_t type, uint16_t id, uint32_t v);  ///< build a log frame with a value
+  bool put(uint8_t* f, uint8_t len);  ///< number, check and buffer a frame
+
+  static constexpr uint32_t fnv(const char* s, uint32_t h)  ///< FNV-1a hash of a string
+    { return(*s == '\0' ? h : fnv(s + 1, (h ^ (uint8_t)*s) * 16777619UL)); }
+  static constexpr uint16_t fold(uint32_t h) { return((h >> 16) ^ (h & 0xffff)); } ///< fold 32 bits to 16
+};
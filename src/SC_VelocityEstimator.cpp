@@ -0,0 +1,39 @@
+/**
+ * \file
+ * \brief Class definition file for the SC_VelocityEstimator class.
+ */
+
+#include <SC_VelocityEstimator.h>
+
+static const int32_t V_LIMIT = (int32_t)INT16_MAX << 4;  ///< largest estimate in fixed point
+
+SC_VelocityEstimator::SC_VelocityEstimator(float alpha)
+{
+  setAlpha(alpha);
+  reset();
+}
+
+void SC_VelocityEstimator::setAlpha(float alpha)
+{
+  alpha = constrain(alpha, 0.0, 1.0);
+
+  _alpha = (uint16_t)(alpha * (1 << GAIN_BITS) + 0.5);
+  _beta = (uint16_t)(((alpha * alpha) / (2.0 - alpha)) * (1 << GAIN_BITS) + 0.5);
+}
+
+int16_t SC_VelocityEstimator::update(int16_t z)
+{
+  int32_t pred = _v + _a;
+  int32_t r = ((int32_t)z << FX_BITS) - pred;
+
+  // the residual is at most 2 x V_LIMIT (21 bits), so the products fit in 32 bits
+  _v = constrain(pred + ((r * _alpha) >> GAIN_BITS), -V_LIMIT, V_LIMIT);
+  _a = constrain(_a + ((r * _beta) >> GAIN_BITS), -V_LIMIT, V_LIMIT);
+
+  return(getVelocity());
+}
+
+int16_t SC_VelocityEstimator::getVelocity(void)
+{
+  return((int16_t)constrain((_v + (1 << (FX_BITS - 1))) >> FX_BITS, INT16_MIN, INT16_MAX));
+}
@@ -0,0 +1,146 @@
+#pragma once
+/**
+ * \file
+ * \brief Header file for the SC_VelocityEstimator class of the MD_SmartCar library.
+ */
+
+/**
+ \page pageVelocityEstimator Velocity Estimation
+
+ ## SmartCar Velocity Estimation
+
+ The speed read from the motor encoder each PID period is a measurement of
+ the average speed since the last reading. With the small number of pulses
+ per revolution of a typical hobby encoder this reading is noisy, especially
+ at low speed, and the PID derivative term amplifies the noise.
+
+ SC_VelocityEstimator smooths the readings with an alpha-beta filter, a
+ steady state form of the Kalman filter for a constant acceleration model.
+ Each step the filter predicts the velocity from its last estimate and
+ acceleration, then corrects both by a fraction of the difference (the
+ residual r) between the prediction and the new measurement z
+
+ v<sub>p</sub> = v + a<br>
+ r = z - v<sub>p</sub><br>
+ v = v<sub>p</sub> + &alpha;r<br>
+ a = a + &beta;r
+
+ where the acceleration a is the change in velocity per step. Alpha sets
+ how much the estimate trusts each new reading - 1.0 passes the readings
+ straight through and smaller values smooth more but respond more slowly.
+ Beta is calculated from alpha using the Benedict-Bordner relationship
+
+ &beta; = &alpha;<sup>2</sup> / (2 - &alpha;)
+
+ which gives the best response to a change in acceleration for the amount of
+ smoothing. Because the filter tracks the acceleration it does not lag behind
+ a steady change in speed the way a simple low pass filter does.
+
+ The filter is calculated in fixed point and works in the same units as the
+ readings, with 4 extra fraction bits internally. It is used by MD_SmartCar
+ with the readings in fixed point pulses per second (see SPEED_FX_BITS), so
+ that speeds between whole pulses per second can be represented. The alpha
+ gain is set by MD_SmartCar::setSpeedFilter().
+
+ The filter works per PID step, so the same alpha smooths over a longer time
+ with a longer PID period. The default is no filtering (alpha 1.0), as the
+ encoder readings over the default PID period are already smooth and the 
+ filter lag slows the speed control. It is most useful with short PID periods,
+ where only a few pulses are counted in each period.
+ */
+
+#include <Arduino.h>
+
+/**
+ * Core object for the SC_VelocityEstimator class
+ * Alpha-beta filter to smooth encoder velocity readings.
+ */
+class SC_VelocityEstimator
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class. The estimate starts at 0.
+   *
+   * \param alpha the alpha gain (0.0 to 1.0, default 1.0 = no filtering).
+   */
+  SC_VelocityEstimator(float alpha = 1.0);
+
+  /**
+   * Class Destructor.
+   *
+   * Release any allocated memory and clean up anything else.
+   */
+  ~SC_VelocityEstimator(void) {}
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+   * @{
+   */
+  /**
+   * Set the filter gain.
+   *
+   * Set the alpha gain of the filter. The beta gain is worked out from
+   * alpha. 1.0 means the readings are not filtered. Values outside the
+   * range 0.0 to 1.0 are limited to the range.
+   *
+   * \param alpha the alpha gain.
+   */
+  void setAlpha(float alpha);
+
+  /**
+   * Reset the estimate.
+   *
+   * Set the estimated velocity, with no acceleration. Use this when the
+   * velocity is known to have changed suddenly (eg, the motor has been
+   * stopped or reversed).
+   *
+   * \param v the velocity.
+   */
+  void reset(int16_t v = 0) { _v = (int32_t)v << FX_BITS; _a = 0; }
+
+  /**
+   * Update the estimate with a new reading.
+   *
+   * Call once every time a new reading is taken, at a constant interval.
+   *
+   * \param z the velocity reading.
+   * \return the new velocity estimate, in the same units as z.
+   */
+  int16_t update(int16_t z);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Utility Functions.
+   * @{
+   */
+  /**
+   * Return the current velocity estimate.
+   *
+   * \return The velocity estimated at the last update.
+   */
+  int16_t getVelocity(void);
+
+  /**
+   * Return the alpha gain.
+   *
+   * \return The alpha gain.
+   */
+  inline float getAlpha(void) { return((float)_alpha / (1 << GAIN_BITS)); }
+  /** @} */
+
+private:
+  static const uint8_t FX_BITS = 4;     ///< fraction bits of the estimates
+  static const uint8_t GAIN_BITS = 8;   ///< fraction bits of the gains
+
+  uint16_t _alpha;  ///< alpha gain in fixed point
+  uint16_t _beta;   ///< beta gain in fixed point
+  int32_t _v;       ///< velocity estimate in fixed point
+  int32_t _a;       ///< acceleration estimate (change in velocity per update) in fixed point
+};